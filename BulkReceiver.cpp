@@ -0,0 +1,335 @@
+/**
+ * @file BulkReceiver.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "BulkReceiver.h"
+
+#include <algorithm>
+
+namespace
+{
+    // The client gave up in the middle of a frame or a session, the partial file stays for resuming
+    const unsigned long kIdleTimeoutMs = 5000;
+
+    uint32_t read_u32(const uint8_t *p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    void write_u32(uint8_t *p, uint32_t value)
+    {
+        p[0] = value, p[1] = value >> 8, p[2] = value >> 16, p[3] = value >> 24;
+    }
+}
+
+/**
+ * @brief CRC32 (IEEE 802.3, the zlib one), a nibble table keeps the flash footprint small.
+ * @param crc The CRC of the preceding data, 0 to start.
+ */
+uint32_t BulkReceiver::crc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    while (length--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Tells if the channel input belongs to the framed transfer.
+ * @param channel The Serial or BT channel about to be read.
+ * @param atLineStart True if no text line is being collected, the frames never start mid-line.
+ * @return True if the caller shall hand the channel over to poll() instead of the line protocol.
+ */
+bool BulkReceiver::claims(Stream &channel, bool atLineStart)
+{
+    if (active)
+        return owner == &channel;
+    if (!atLineStart || !channel.available() || channel.peek() != Sync0)
+        return false;
+
+    active = true;
+    owner = &channel;
+    rxState = RxState::HUNT_SYNC0;
+    lastByteMs = millis();
+    return true;
+}
+
+/**
+ * @brief Consumes the available frames, never waits for the input.
+ */
+void BulkReceiver::poll(Stream &channel)
+{
+    while (channel.available())
+    {
+        lastByteMs = millis();
+        switch (rxState)
+        {
+        case RxState::HUNT_SYNC0:
+            // Outside a session only the frames belong to us, give the text back to the line protocol
+            if (!sessionOpen && channel.peek() != Sync0)
+            {
+                active = false;
+                owner = nullptr;
+                return;
+            }
+            if (channel.read() == Sync0)
+                rxState = RxState::HUNT_SYNC1;
+            break;
+
+        case RxState::HUNT_SYNC1:
+        {
+            int c = channel.read();
+            if (c == Sync1)
+            {
+                rxState = RxState::FRAME;
+                framePos = 0;
+                frameNeed = 3;
+            }
+            else if (c != Sync0)
+                rxState = RxState::HUNT_SYNC0;
+            break;
+        }
+
+        case RxState::FRAME:
+            framePos += channel.readBytes(frame + framePos,
+                                          std::min<size_t>(frameNeed - framePos, channel.available()));
+            if (framePos < frameNeed)
+                break;
+            if (frameNeed == 3)
+            {
+                uint16_t length = frame[1] | (frame[2] << 8);
+                if (length > 4 + MaxChunk)
+                {
+                    rxState = RxState::HUNT_SYNC0; // can't be ours, resync
+                    break;
+                }
+                frameNeed = 3 + length + 4;
+                if (framePos < frameNeed)
+                    break;
+            }
+            {
+                uint16_t length = frameNeed - 3 - 4;
+                rxState = RxState::HUNT_SYNC0;
+                if (crc32(0, frame, 3 + length) == read_u32(frame + 3 + length))
+                    handleFrame(channel, frame[0], frame + 3, length);
+                else if (sessionOpen)
+                    sendAck(channel); // damaged frame, repeat where we are
+            }
+            break;
+        }
+    }
+
+    // The input is drained, time for the delayed ack
+    if (unackedFrames > 0)
+        sendAck(channel);
+
+    if (!sessionOpen && rxState == RxState::HUNT_SYNC0)
+    {
+        active = false;
+        owner = nullptr;
+    }
+    else if (millis() - lastByteMs > kIdleTimeoutMs)
+    {
+        stream_logger.printf("BulkReceiver: %s timed out at %u of %u bytes\n",
+                             targetName.c_str(), expected, totalSize);
+        closeSession();
+        rxState = RxState::HUNT_SYNC0;
+        active = false;
+        owner = nullptr;
+    }
+}
+
+void BulkReceiver::handleFrame(Stream &channel, uint8_t type, const uint8_t *payload, uint16_t length)
+{
+    switch (type)
+    {
+    case 'B':
+        onBegin(channel, payload, length);
+        break;
+    case 'D':
+        onData(channel, payload, length);
+        break;
+    case 'E':
+        onEnd(channel);
+        break;
+    case 'X':
+        stream_logger.printf("BulkReceiver: %s aborted at %u bytes\n", targetName.c_str(), expected);
+        closeSession();
+        break;
+    default:
+        break;
+    }
+}
+
+void BulkReceiver::onBegin(Stream &channel, const uint8_t *payload, uint16_t length)
+{
+    if (length < 9 || length > 8 + 31)
+        return;
+    uint32_t size = read_u32(payload);
+    uint32_t crc = read_u32(payload + 4);
+    std::string name((const char *)payload + 8, length - 8);
+    if (name[0] != '/')
+        name = "/" + name;
+
+    // A repeated "begin" of the running session, its ack got lost
+    if (sessionOpen && size == totalSize && crc == fileCrc && name == targetName)
+    {
+        sendAck(channel);
+        return;
+    }
+    closeSession();
+
+    targetName = name;
+    totalSize = size;
+    fileCrc = crc;
+    expected = 0;
+    runningCrc = 0;
+    snprintf(partName, sizeof(partName), "/up_%08x.part", (unsigned)crc);
+
+    // Resume: the partial file of the same content, its CRC gets the running CRC up to date
+    if (SPIFFS.exists(partName))
+    {
+        File part = SPIFFS.open(partName, FILE_READ);
+        if (part && part.size() <= totalSize)
+        {
+            uint8_t buffer[64];
+            size_t n;
+            while ((n = part.read(buffer, sizeof(buffer))) > 0)
+            {
+                runningCrc = crc32(runningCrc, buffer, n);
+                expected += n;
+            }
+        }
+        if (part)
+            part.close();
+        if (expected == 0)
+            SPIFFS.remove(partName);
+    }
+
+    file = SPIFFS.open(partName, FILE_APPEND);
+    if (!file)
+    {
+        stream_logger.printf("BulkReceiver: failed to open %s for writing\n", partName);
+        uint8_t fin[5];
+        write_u32(fin, fileCrc);
+        fin[4] = 2;
+        sendFrame(channel, 'F', fin, sizeof(fin));
+        return;
+    }
+    sessionOpen = true;
+    stream_logger.printf("BulkReceiver: receiving %s, %u bytes, resuming at %u\n",
+                         targetName.c_str(), totalSize, expected);
+    sendAck(channel);
+}
+
+void BulkReceiver::onData(Stream &channel, const uint8_t *payload, uint16_t length)
+{
+    if (!sessionOpen || length < 4)
+        return;
+    uint32_t offset = read_u32(payload);
+    const uint8_t *chunk = payload + 4;
+    uint16_t chunkLength = length - 4;
+
+    // Lost or reordered frame, go back: the client resends everything from the expected offset
+    if (offset != expected || offset + chunkLength > totalSize)
+    {
+        sendAck(channel);
+        return;
+    }
+
+    if (file.write(chunk, chunkLength) != chunkLength)
+    {
+        stream_logger.printf("BulkReceiver: failed to write %s\n", partName);
+        closeSession();
+        uint8_t fin[5];
+        write_u32(fin, fileCrc);
+        fin[4] = 2;
+        sendFrame(channel, 'F', fin, sizeof(fin));
+        return;
+    }
+    expected += chunkLength;
+    runningCrc = crc32(runningCrc, chunk, chunkLength);
+    if (++unackedFrames >= Window / 2)
+        sendAck(channel);
+}
+
+void BulkReceiver::onEnd(Stream &channel)
+{
+    if (sessionOpen && expected < totalSize)
+    {
+        sendAck(channel); // still missing the tail
+        return;
+    }
+
+    uint8_t fin[5];
+    write_u32(fin, fileCrc);
+    fin[4] = 2;
+    if (sessionOpen)
+    {
+        file.close();
+        sessionOpen = false;
+        if (runningCrc != fileCrc)
+        {
+            fin[4] = 1;
+            SPIFFS.remove(partName);
+        }
+        else
+        {
+            SPIFFS.remove(targetName.c_str());
+            fin[4] = SPIFFS.rename(partName, targetName.c_str()) ? 0 : 2;
+        }
+        stream_logger.printf("BulkReceiver: %s %s, %u bytes\n", targetName.c_str(),
+                             fin[4] == 0 ? "stored" : "failed", totalSize);
+    }
+    else if (!targetName.empty() && SPIFFS.exists(targetName.c_str()) && !SPIFFS.exists(partName))
+    {
+        fin[4] = 0; // a repeated "end", the "fin" got lost
+    }
+    sendFrame(channel, 'F', fin, sizeof(fin));
+}
+
+void BulkReceiver::closeSession()
+{
+    if (sessionOpen)
+        file.close();
+    sessionOpen = false;
+    unackedFrames = 0;
+}
+
+void BulkReceiver::sendAck(Stream &channel)
+{
+    uint8_t ack[6];
+    write_u32(ack, expected);
+    ack[4] = Window & 0xFF;
+    ack[5] = Window >> 8;
+    sendFrame(channel, 'A', ack, sizeof(ack));
+    unackedFrames = 0;
+}
+
+void BulkReceiver::sendFrame(Stream &channel, uint8_t type, const uint8_t *payload, uint16_t length)
+{
+    // the replies are tiny, one write per frame keeps them in one packet
+    uint8_t buffer[2 + 3 + 8 + 4];
+    if (length > 8)
+        return;
+    buffer[0] = Sync0;
+    buffer[1] = Sync1;
+    buffer[2] = type;
+    buffer[3] = length & 0xFF;
+    buffer[4] = length >> 8;
+    memcpy(buffer + 5, payload, length);
+    write_u32(buffer + 5 + length, crc32(0, buffer + 2, 3 + length));
+    channel.write(buffer, 5 + length + 4);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file BulkReceiver.h
+ * @brief A framed binary transfer mode streaming the bulk uploads (crontab, paths) into SPIFFS.
+ *
+ * The line protocol reads the bulk data one byte at a time, echoes it back and makes the client
+ * throttle itself. The framed mode lets the client keep a window of chunks in flight and
+ * checks every frame with CRC32, the receiver writes the chunks straight into the file.
+ *
+ * Every frame, in both directions:
+ *
+ *     0xA5 0x5A | type (1) | length (2, LE) | payload (length) | CRC32 (4, LE) of type..payload
+ *
+ * Client to controller:
+ *     'B' begin   total size (4), file CRC32 (4), file name (up to 31 chars, e.g. "/crontab")
+ *     'D' data    offset (4), up to MaxChunk bytes
+ *     'E' end     no payload
+ *     'X' abort   no payload, the partial file is kept for resuming
+ * Controller to client:
+ *     'A' ack     the next expected offset (4), the window in frames (2)
+ *     'F' fin     the file CRC32 (4), status (1): 0 stored, 1 CRC mismatch, 2 file error
+ *
+ * The acks are cumulative (go-back-N): a data frame with an unexpected offset or a bad CRC is
+ * dropped and the current offset is acked again, the client resends from there. The acks are
+ * delayed until a few frames arrive or the input is drained, to save the airtime.
+ * The partial file is named after the file CRC, so the "begin" of the same file after
+ * a disconnect resumes from the stored size.
+ * The frames are recognized by the 0xA5 at the start of a line, so the text commands work as before,
+ * the text logged during the transfer may interleave with the acks, the client hunts for the sync bytes.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+#include "SPIFFS.h"
+
+#include <string>
+
+#include "StreamLogger.h"
+
+class BulkReceiver
+{
+public:
+    static const uint8_t Sync0 = 0xA5;
+    static const uint8_t Sync1 = 0x5A;
+    static const uint16_t MaxChunk = 512;
+    static const uint16_t Window = 8;
+
+    bool claims(Stream &channel, bool atLineStart);
+    void poll(Stream &channel);
+    bool isActive() const { return active; }
+
+    static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length);
+
+private:
+    enum class RxState : uint8_t
+    {
+        HUNT_SYNC0,
+        HUNT_SYNC1,
+        FRAME
+    };
+
+    // type (1) + length (2) + offset (4) + chunk + CRC (4)
+    uint8_t frame[3 + 4 + MaxChunk + 4];
+    size_t framePos = 0;
+    size_t frameNeed = 3;
+    RxState rxState = RxState::HUNT_SYNC0;
+    unsigned long lastByteMs = 0;
+
+    bool active = false;      // a frame or a session is in progress on the channel
+    Stream *owner = nullptr;  // the channel the session belongs to
+    bool sessionOpen = false; // "begin" received, the file is open
+    File file;
+    std::string targetName;
+    char partName[20];
+    uint32_t totalSize = 0;
+    uint32_t fileCrc = 0;
+    uint32_t expected = 0;    // next expected offset, everything below is in the file
+    uint32_t runningCrc = 0;  // CRC32 of the bytes below the expected offset
+    uint8_t unackedFrames = 0;
+
+    void handleFrame(Stream &channel, uint8_t type, const uint8_t *payload, uint16_t length);
+    void onBegin(Stream &channel, const uint8_t *payload, uint16_t length);
+    void onData(Stream &channel, const uint8_t *payload, uint16_t length);
+    void onEnd(Stream &channel);
+    void closeSession();
+    void sendAck(Stream &channel);
+    void sendFrame(Stream &channel, uint8_t type, const uint8_t *payload, uint16_t length);
+};
+
+extern BulkReceiver bulk_receiver;
@@ -1,157 +1,342 @@
-#include "ClockHelper.h"
-
-/**
- * @brief Initializes the RTC and sets its time if it lost power.
- * @return True if initialization is successful, false if RTC is not found or another error occurs.
- *
- * This function attempts to begin communication with the RTC. If the RTC had lost power,
- * it sets the RTC time to the time when the sketch was compiled. It also turns off the
- * square wave output to avoid noise.
- */
-bool ClockHelper::delayed_setup()
-{
-    if (!this->begin())
-    {
-        stream_logger.println("Couldn't find RTC");
-        return false;
-    }
-
-    if (this->lostPower())
-    {
-        stream_logger.println("RTC lost power, setting the time!");
-        // Following line sets the RTC to the date & time this sketch was compiled
-        this->adjust(DateTime(F(__DATE__), F(__TIME__)));
-    }
-
-    // Turning off the output of the calibrated frequency, cause we don't want the noise
-    this->writeSqwPinMode(DS3231_OFF);
-
-    this->synchronize_esp32_to_rtc();
-
-    return true;
-}
-
-/**
- * @brief Outputs the current time stamp to the serial stream.
- *
- * Retrieves the current system time and formats it into a human-readable string,
- * which is then output to the serial stream. The format used is 'YYYY-MM-DD HH:MM:SS'.
- */
-void ClockHelper::time_stamp_to_serial()
-{
-    char buffer[80];
-    std::time_t t = std::time(nullptr);
-    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
-    stream_logger.printf("========  %s  ========\n", buffer);
-}
-
-/**
- * @brief Sets the controller clock to a specified date and time.
- * @param dateTimeString The date and time in ISO 8601 format (YYYY-MM-DDTHH:MM:SS).
- * @return True if the time was set successfully, false otherwise.
- *
- * This function parses the given date and time string, adjusts the RTC,
- * and synchronizes the ESP32 internal clock to the RTC.
- */
-bool ClockHelper::set_controller_clock(const std::string &dateTimeString)
-{
-    stream_logger.printf("ClockHelper::set_controller_clock(%s)\n", dateTimeString.c_str());
-
-    std::tm tm = {};
-    std::istringstream time_stream(dateTimeString);
-    time_stream >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S"); // expects YYYY-MM-DDTHH:MM:SS
-    if (time_stream.fail())
-    {
-        stream_logger.println("Error: Invalid date/time string.");
-        return false;
-    }
-
-    // set the RTC with an explicit date & time
-    this->adjust(DateTime(tm.tm_year, tm.tm_mon, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec));
-
-    return this->synchronize_esp32_to_rtc();
-}
-
-/**
- * @brief Synchronizes the ESP32 internal clock to the RTC time.
- * @return True if synchronization is successful, false otherwise.
- *
- * Retrieves the current time from the RTC and updates the ESP32 internal clock.
- */
-bool ClockHelper::synchronize_esp32_to_rtc()
-{
-    // Get the time from RTC
-    DateTime now = this->now();
-
-    // Set ESP32 internal clock
-    return set_esp32_clock(
-        now.year(), now.month(), now.day(), now.hour(), now.minute(), now.second());
-}
-
-/**
- * @brief Synchronizes the ESP32 clock to RTC every 24 hours.
- * @return True if synchronization occurs, false if not yet 24 hours since last sync.
- *
- * Checks if 24 hours have passed since the last synchronization and,
- * if so, synchronizes the ESP32 clock to the RTC.
- */
-bool ClockHelper::synchronize_esp32_to_rtc_at_24_hours()
-{
-    // Every 24 hours, synchronize time
-    static unsigned long lastSyncTime = 0;
-    if (millis() - lastSyncTime > 86400000)
-    { // 86400000 ms = 24 hours
-        lastSyncTime = millis();
-        return synchronize_esp32_to_rtc();
-    }
-    return false;
-}
-
-/**
- * @brief Sets the ESP32 system clock.
- * @param year Year to set (Note: the year should be in full format, e.g., 2023).
- * @param month Month to set (1-12).
- * @param day Day to set (1-31).
- * @param hour Hour to set (0-23).
- * @param minute Minute to set (0-59).
- * @param second Second to set (0-59).
- * @return True if the time was set successfully, false otherwise.
- *
- * Converts the provided date and time into a format suitable for the ESP32 system clock
- * and sets the system time accordingly. The function adjusts the year to be compatible
- * with the std::tm structure by subtracting 2000 from the input year.
- */
-bool ClockHelper::set_esp32_clock(int year, int month, int day, int hour, int minute, int second)
-{
-    std::tm tm = {
-        // The order is important to keep compiler happy
-        .tm_sec = second,
-        .tm_min = minute,
-        .tm_hour = hour,
-        .tm_mday = day,
-        .tm_mon = month,
-        .tm_year = year - 2000, // My version of ESP32 libraries counts the year starting from 2000
-    };
-
-    // Convert tm to time_t then to timeval
-    std::time_t t = std::mktime(&tm);
-    if (t == -1)
-    {
-        stream_logger.println("Error: Unable to make time.");
-        return false;
-    }
-
-    // Now we need to create a timeval struct and set it using settimeofday
-    struct timeval now = {.tv_sec = t, .tv_usec = 0};
-    if (settimeofday(&now, nullptr) != 0)
-    {
-        stream_logger.println("Error: Failed to set time.");
-        return false;
-    }
-
-    // For logging, convert the time to a string
-    char buf[64];
-    strftime(buf, sizeof(buf), "%c", &tm);
-    stream_logger.printf("Setting controller clock to: %s\n", buf);
-    return true;
-}
+#include "ClockHelper.h"
+
+/**
+ * @brief Initializes the RTC and sets its time if it lost power.
+ * @return True if initialization is successful, false if RTC is not found or another error occurs.
+ *
+ * This function attempts to begin communication with the RTC. If the RTC had lost power,
+ * it sets the RTC time to the time when the sketch was compiled, see set_rtc_to_build_time().
+ * It also turns off the square wave output to avoid noise.
+ */
+bool ClockHelper::delayed_setup()
+{
+    if (!this->begin())
+    {
+        stream_logger.println("Couldn't find RTC");
+        return false;
+    }
+
+    if (this->lostPower())
+    {
+        stream_logger.println("RTC lost power, setting the time!");
+        // the time zone is not restored yet, restore_time_zone() sets the build time again
+        this->set_rtc_to_build_time();
+        this->rtc_from_build_time = true;
+    }
+
+    // Turning off the output of the calibrated frequency, cause we don't want the noise
+    this->writeSqwPinMode(DS3231_OFF);
+
+    this->synchronize_esp32_to_rtc();
+
+    return true;
+}
+
+/**
+ * @brief Outputs the current time stamp to the serial stream.
+ *
+ * Retrieves the current system time and formats it into a human-readable string,
+ * which is then output to the serial stream. The format used is 'YYYY-MM-DD HH:MM:SS'.
+ */
+void ClockHelper::time_stamp_to_serial()
+{
+    char buffer[80];
+    std::time_t t = this->utc_to_local(std::time(nullptr));
+    std::tm tm;
+    gmtime_r(&t, &tm);
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    stream_logger.printf("========  %s  ========\n", buffer);
+}
+
+/**
+ * @brief Sets the controller clock to a specified date and time.
+ * @param dateTimeString The date and time in ISO 8601 format, YYYY-MM-DDTHH:MM:SS optionally
+ * followed by "Z" for UTC or the UTC offset "+HH:MM" / "-HH:MM".
+ * @return True if the time was set successfully, false otherwise.
+ *
+ * This function parses the given date and time string, adjusts the RTC,
+ * and synchronizes the ESP32 internal clock to the RTC.
+ * The RTC keeps UTC. A time without the offset is the local wall clock, see set_time_zone(),
+ * a local time repeated by the DST switch resolves to the occurrence closest to the current clock.
+ */
+bool ClockHelper::set_controller_clock(const std::string &dateTimeString)
+{
+    stream_logger.printf("ClockHelper::set_controller_clock(%s)\n", dateTimeString.c_str());
+
+    std::tm tm = {};
+    std::istringstream time_stream(dateTimeString);
+    time_stream >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S"); // expects YYYY-MM-DDTHH:MM:SS
+    if (time_stream.fail())
+    {
+        stream_logger.println("Error: Invalid date/time string.");
+        return false;
+    }
+
+    std::string zone;
+    time_stream >> zone;
+    int32_t offset = 0;
+    if (!zone.empty() && !parse_utc_offset(zone, offset))
+    {
+        stream_logger.println("Error: Invalid UTC offset.");
+        return false;
+    }
+
+    int64_t days = TimeZoneRules::days_from_civil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+    std::time_t time = days * TimeZoneRules::seconds_per_day + tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    std::time_t utc;
+    if (zone.empty())
+    {
+        std::time_t now = std::time(nullptr);
+        portENTER_CRITICAL(&tz_lock);
+        utc = tz_rules.local_to_utc(time, now);
+        portEXIT_CRITICAL(&tz_lock);
+    }
+    else
+        utc = time - offset;
+    gmtime_r(&utc, &tm);
+    this->rtc_from_build_time = false;
+
+    // set the RTC with an explicit date & time, DateTime takes the full year and the month 1-12
+    this->adjust(DateTime(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec));
+
+    return this->synchronize_esp32_to_rtc();
+}
+
+/**
+ * @brief Synchronizes the ESP32 internal clock to the RTC time.
+ * @return True if synchronization is successful, false otherwise.
+ *
+ * Retrieves the current time from the RTC and updates the ESP32 internal clock.
+ * The RTC set by the earlier firmware holds the tm_year as the year (2124 for 2024)
+ * and the month 0-11, such a reading is decoded and the RTC is rewritten right.
+ */
+bool ClockHelper::synchronize_esp32_to_rtc()
+{
+    // Get the time from RTC
+    DateTime now = this->now();
+    if (now.year() >= 2100)
+    {
+        now = DateTime(now.year() - 100, now.month() + 1, now.day(), now.hour(), now.minute(), now.second());
+        stream_logger.println("RTC holds the legacy year and month, rewriting it");
+        this->adjust(now);
+    }
+
+    // Set ESP32 internal clock
+    if (!set_esp32_clock(now.year(), now.month(), now.day(), now.hour(), now.minute(), now.second()))
+        return false;
+    // the conversions read the system clock, the table shall cover it
+    this->ensure_tz_table_covers(std::time(nullptr));
+    return true;
+}
+
+/**
+ * @brief Synchronizes the ESP32 clock to RTC every 24 hours.
+ * @return True if synchronization occurs, false if not yet 24 hours since last sync.
+ *
+ * Checks if 24 hours have passed since the last synchronization and,
+ * if so, synchronizes the ESP32 clock to the RTC.
+ */
+bool ClockHelper::synchronize_esp32_to_rtc_at_24_hours()
+{
+    // Every 24 hours, synchronize time
+    static unsigned long lastSyncTime = 0;
+    if (millis() - lastSyncTime > 86400000)
+    { // 86400000 ms = 24 hours
+        lastSyncTime = millis();
+        return synchronize_esp32_to_rtc();
+    }
+    return false;
+}
+
+/**
+ * @brief Sets the ESP32 system clock.
+ * @param year Year to set (Note: the year should be in full format, e.g., 2023).
+ * @param month Month to set (1-12).
+ * @param day Day to set (1-31).
+ * @param hour Hour to set (0-23).
+ * @param minute Minute to set (0-59).
+ * @param second Second to set (0-59).
+ * @return True if the time was set successfully, false otherwise.
+ *
+ * The date and time are UTC, like the RTC, so the seconds since the epoch are computed
+ * directly instead of by mktime(), which would apply the libc time zone.
+ */
+bool ClockHelper::set_esp32_clock(int year, int month, int day, int hour, int minute, int second)
+{
+    if (month < 1 || month > 12 || day < 1 || day > 31)
+    {
+        stream_logger.println("Error: Unable to make time.");
+        return false;
+    }
+    int64_t days = TimeZoneRules::days_from_civil(year, month, day);
+    std::time_t t = days * TimeZoneRules::seconds_per_day + hour * 3600 + minute * 60 + second;
+
+    // Now we need to create a timeval struct and set it using settimeofday
+    struct timeval now = {.tv_sec = t, .tv_usec = 0};
+    if (settimeofday(&now, nullptr) != 0)
+    {
+        stream_logger.println("Error: Failed to set time.");
+        return false;
+    }
+
+    // For logging, convert the time to a string
+    std::tm tm;
+    gmtime_r(&t, &tm);
+    char buf[64];
+    strftime(buf, sizeof(buf), "%c", &tm);
+    stream_logger.printf("Setting controller clock to: %s\n", buf);
+    return true;
+}
+
+/**
+ * @brief Configures the time zone of the local wall clock.
+ * @param posix_tz The POSIX TZ string, e.g. "CET-1CEST,M3.5.0,M10.5.0/3" or "UTC0".
+ * @param persist Whether to store the time zone in the flash memory.
+ * @return True if the string is valid and the transition table is rebuilt, false otherwise.
+ *
+ * A zone with the DST name but without the rules switches by the US rules, "M3.2.0,M11.1.0".
+ */
+bool ClockHelper::set_time_zone(const std::string &posix_tz, bool persist)
+{
+    std::time_t now = std::time(nullptr);
+    std::tm tm;
+    gmtime_r(&now, &tm);
+    int transitions = this->build_tz_table(posix_tz, tm.tm_year + 1900 - 1);
+    if (transitions < 0)
+    {
+        stream_logger.printf("Error: Invalid time zone '%s'\n", posix_tz.c_str());
+        return false;
+    }
+    stream_logger.printf("ClockHelper::set_time_zone(%s), %d transitions\n", posix_tz.c_str(), transitions);
+
+    if (persist)
+    {
+        File file = SPIFFS.open("/timezone", FILE_WRITE);
+        if (!file)
+        {
+            stream_logger.println("Failed to open timezone file for writing");
+            return true;
+        }
+        file.print(posix_tz.c_str());
+        file.close();
+    }
+    return true;
+}
+
+/**
+ * @brief Loads the time zone stored by set_time_zone(), keeps UTC if there is none.
+ */
+void ClockHelper::load_time_zone()
+{
+    File file = SPIFFS.open("/timezone", FILE_READ);
+    if (!file)
+    {
+        this->set_time_zone(get_time_zone(), false);
+        return;
+    }
+    String posix_tz = file.readStringUntil('\n');
+    file.close();
+    if (!this->set_time_zone(posix_tz.c_str(), false))
+        this->set_time_zone(get_time_zone(), false);
+}
+
+/**
+ * @brief Restores the time zone, and converts the build time set at the power loss with it.
+ */
+void ClockHelper::restore_time_zone()
+{
+    this->load_time_zone();
+    if (this->rtc_from_build_time)
+    {
+        this->set_rtc_to_build_time();
+        this->synchronize_esp32_to_rtc();
+        this->rtc_from_build_time = false;
+    }
+}
+
+/**
+ * @brief Sets the RTC to the time this sketch was compiled.
+ *
+ * __DATE__ and __TIME__ are the local wall clock of the build, they are converted with
+ * the current time zone, the RTC keeps UTC.
+ */
+void ClockHelper::set_rtc_to_build_time()
+{
+    std::time_t utc = this->local_to_utc(DateTime(F(__DATE__), F(__TIME__)).unixtime());
+    this->adjust(DateTime((uint32_t)utc));
+}
+
+/**
+ * @brief Parses the "Z", "+HH:MM", "-HH:MM" or "+HHMM" suffix of an ISO 8601 time.
+ * @param zone The suffix.
+ * @param offset Receives the seconds to add to UTC to get the time.
+ * @return True if the suffix is valid.
+ */
+bool ClockHelper::parse_utc_offset(const std::string &zone, int32_t &offset)
+{
+    if (zone == "Z")
+    {
+        offset = 0;
+        return true;
+    }
+    int hours = 0, minutes = 0;
+    char colon = ':';
+    if ((zone.size() != 6 && zone.size() != 5) || (zone[0] != '+' && zone[0] != '-'))
+        return false;
+    int fields = zone.size() == 6 ? sscanf(zone.c_str() + 1, "%2d%c%2d", &hours, &colon, &minutes)
+                                  : sscanf(zone.c_str() + 1, "%2d%2d", &hours, &minutes) + 1;
+    if (fields != 3 || colon != ':' || hours > 14 || minutes > 59)
+        return false;
+    offset = (zone[0] == '-' ? -1 : 1) * (hours * 3600 + minutes * 60);
+    return true;
+}
+
+/**
+ * @brief Converts UTC to the local wall clock, see TimeZoneRules::utc_to_local().
+ */
+std::time_t ClockHelper::utc_to_local(std::time_t utc)
+{
+    portENTER_CRITICAL(&tz_lock);
+    std::time_t local = tz_rules.utc_to_local(utc);
+    portEXIT_CRITICAL(&tz_lock);
+    return local;
+}
+
+/**
+ * @brief Converts the local wall clock to UTC, see TimeZoneRules::local_to_utc().
+ */
+std::time_t ClockHelper::local_to_utc(std::time_t local)
+{
+    portENTER_CRITICAL(&tz_lock);
+    std::time_t utc = tz_rules.local_to_utc(local);
+    portEXIT_CRITICAL(&tz_lock);
+    return utc;
+}
+
+/**
+ * @brief Builds the table aside and swaps it in, the critical section only swaps the pointers.
+ * @return The number of the transitions, or -1 if the string is malformed, the current table stays intact then.
+ */
+int ClockHelper::build_tz_table(const std::string &posix_tz, int first_year)
+{
+    TimeZoneRules rules;
+    if (!rules.build(posix_tz, first_year))
+        return -1;
+    int transitions = (int)rules.get_transitions().size();
+    portENTER_CRITICAL(&tz_lock);
+    tz_rules.swap(rules);
+    portEXIT_CRITICAL(&tz_lock);
+    return transitions;
+}
+
+/**
+ * @brief Rebuilds the transition table when the clock gets close to its end.
+ */
+void ClockHelper::ensure_tz_table_covers(std::time_t utc)
+{
+    std::tm tm;
+    gmtime_r(&utc, &tm);
+    int year = tm.tm_year + 1900;
+    if (!tz_rules.covers(year))
+        this->build_tz_table(tz_rules.get_posix_tz(), year - 1);
+}
@@ -1,29 +1,60 @@
-#pragma once
-#include <Arduino.h>
-#include <ctime>
-#include <sys/time.h>
-#include <iomanip>
-#include <sstream>
-
-#include <Wire.h>
-#include <RTClib.h>
-
-#include "StreamLogger.h"
-
-class ClockHelper : RTC_DS3231
-{
-public:
-    ClockHelper(){
-        // this->setup();
-    };
-
-    bool delayed_setup();
-    void time_stamp_to_serial();
-    bool set_controller_clock(const std::string &dateTimeString);
-    bool synchronize_esp32_to_rtc();
-    bool synchronize_esp32_to_rtc_at_24_hours();
-    bool set_esp32_clock(int year, int month, int day, int hour, int minute, int second);
-};
-
-// Global logger instance declaration
+#pragma once
+#include <Arduino.h>
+#include <ctime>
+#include <sys/time.h>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Wire.h>
+#include <RTClib.h>
+
+#include "SPIFFS.h"
+
+#include "StreamLogger.h"
+#include "TimeZoneRules.h"
+
+/**
+ * The RTC and the ESP32 system clock keep UTC. The local wall clock is computed from
+ * a table of the offset transitions precomputed from the POSIX TZ string
+ * (e.g. "EST5EDT,M3.2.0,M11.1.0", see TimeZoneRules.h), so the conversion is a binary search
+ * plus an add, no libc TZ rules evaluated on every call. The default "UTC0" keeps the wall clock equal to UTC.
+ */
+class ClockHelper : RTC_DS3231
+{
+public:
+    ClockHelper(){
+        // this->setup();
+    };
+
+    bool delayed_setup();
+    void time_stamp_to_serial();
+    bool set_controller_clock(const std::string &dateTimeString);
+    bool synchronize_esp32_to_rtc();
+    bool synchronize_esp32_to_rtc_at_24_hours();
+    bool set_esp32_clock(int year, int month, int day, int hour, int minute, int second);
+
+    bool set_time_zone(const std::string &posix_tz, bool persist = true);
+    void restore_time_zone();
+    std::string get_time_zone() const { return tz_rules.get_posix_tz(); }
+    std::time_t utc_to_local(std::time_t utc);
+    std::time_t local_to_utc(std::time_t local);
+
+private:
+    // The table covers TimeZoneRules::table_years years starting with the previous year
+    TimeZoneRules tz_rules;
+    portMUX_TYPE tz_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    // The RTC holds the build time since the power loss, converted before the time zone was restored
+    bool rtc_from_build_time = false;
+
+    int build_tz_table(const std::string &posix_tz, int first_year);
+    void ensure_tz_table_covers(std::time_t utc);
+    void load_time_zone();
+    void set_rtc_to_build_time();
+    static bool parse_utc_offset(const std::string &zone, int32_t &offset);
+};
+
+// Global logger instance declaration
 extern ClockHelper runtime_clock_helper;
\ No newline at end of file
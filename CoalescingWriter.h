@@ -0,0 +1,106 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <vector>
+
+/**
+ * @brief Gathers the small writes (echoes, heartbeat dots, prefix and payload prints)
+ * into the link sized chunks, every write into the BT SPP stack costs a packet.
+ *
+ * The pending bytes go out when the buffer fills up, on flush(), or by flush_if_due()
+ * once the oldest pending byte has waited longer than the latency deadline.
+ * The writes larger than the buffer pass through in one piece.
+ */
+class CoalescingWriter : public Print
+{
+public:
+    struct Stats
+    {
+        uint32_t writes;           // writes into the underlying stream
+        uint32_t bytes;            // bytes written into the underlying stream
+        uint32_t flushes_full;     // the buffer got full
+        uint32_t flushes_deadline; // the latency deadline expired
+        uint32_t flushes_explicit; // flush() called
+    };
+
+    CoalescingWriter(Print &target, size_t mtu, unsigned long deadline_ms = 10)
+        : target(target), mtu(mtu), deadline_ms(deadline_ms), lock(xSemaphoreCreateMutex())
+    {
+        buffer.reserve(mtu);
+    }
+
+    size_t write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        if (buffer.size() + size > mtu)
+            flush_locked(stats.flushes_full);
+        if (size >= mtu)
+        {
+            // too big to coalesce, one write is still the cheapest
+            stats.writes++;
+            stats.bytes += size;
+            target.write(data, size);
+        }
+        else
+        {
+            if (buffer.empty())
+                first_pending_ms = millis();
+            buffer.insert(buffer.end(), data, data + size);
+            if (buffer.size() == mtu)
+                flush_locked(stats.flushes_full);
+        }
+        xSemaphoreGive(lock);
+        return size;
+    }
+
+    void flush() override
+    {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        flush_locked(stats.flushes_explicit);
+        xSemaphoreGive(lock);
+    }
+
+    // Call it from the loop(), sends the pending bytes older than the deadline
+    void flush_if_due()
+    {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        if (!buffer.empty() && millis() - first_pending_ms >= deadline_ms)
+            flush_locked(stats.flushes_deadline);
+        xSemaphoreGive(lock);
+    }
+
+    Stats get_stats()
+    {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        Stats snapshot = stats;
+        xSemaphoreGive(lock);
+        return snapshot;
+    }
+
+private:
+    Print &target;
+    size_t mtu;
+    unsigned long deadline_ms;
+    SemaphoreHandle_t lock;
+    std::vector<uint8_t> buffer;
+    unsigned long first_pending_ms = 0;
+    Stats stats = {};
+
+    void flush_locked(uint32_t &reason)
+    {
+        if (buffer.empty())
+            return;
+        reason++;
+        stats.writes++;
+        stats.bytes += buffer.size();
+        target.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+};
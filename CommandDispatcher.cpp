@@ -0,0 +1,176 @@
+/**
+ * @file CommandDispatcher.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "CommandDispatcher.h"
+
+#include <algorithm>
+
+CommandDispatcher::CommandDispatcher(size_t capacity, uint8_t workers)
+    : capacity(capacity), workerCount(workers)
+{
+}
+
+/**
+ * @brief Creates the queue primitives and starts the worker tasks.
+ * @param func The command processor entry point, the workers call it for every fired task.
+ * @return True if the pool is up and running (or already was), false if FreeRTOS refused.
+ */
+bool CommandDispatcher::begin(CommandFunc func)
+{
+    if (isRunning())
+        return true;
+
+    commandFunc = func;
+    queue.reserve(capacity);
+    queueMutex = xSemaphoreCreateMutex();
+    jobsAvailable = xSemaphoreCreateCounting(capacity, 0);
+    if (queueMutex == nullptr || jobsAvailable == nullptr)
+    {
+        stream_logger.println("CommandDispatcher: failed to create the queue semaphores");
+        return false;
+    }
+
+    for (uint8_t i = 0; i < workerCount; ++i)
+    {
+        TaskHandle_t handle = nullptr;
+        // 8K of stack, the command processor parses JSON and the logger formats into 1K buffers
+        if (xTaskCreate(workerEntry, "sched_worker", 8192, this, 1, &handle) != pdPASS)
+        {
+            stream_logger.printf("CommandDispatcher: failed to start worker #%d\n", i);
+            break;
+        }
+        workerHandles.push_back(handle);
+    }
+    return isRunning();
+}
+
+bool CommandDispatcher::lowerPriority(const Job &a, const Job &b)
+{
+    if (a.priority != b.priority)
+        return a.priority < b.priority;
+    // the sequence is allowed to wrap around, compare the distance
+    return (int32_t)(a.sequence - b.sequence) > 0;
+}
+
+/**
+ * @brief Puts a fired task into the queue, never blocks longer than the queue mutex.
+ * @param task The task that has just fired.
+ * @return True if the fire was accepted, queued or folded into the queued run of the task,
+ * false if it was dropped by the overlap policy or because the queue was full.
+ */
+bool CommandDispatcher::submit(const std::shared_ptr<ScheduledTask> &task)
+{
+    OverlapPolicy policy = task->getOverlapPolicy();
+    if (policy == OverlapPolicy::SKIP)
+    {
+        uint8_t idle = 0;
+        if (!task->inFlight.compare_exchange_strong(idle, 1))
+        {
+            xSemaphoreTake(queueMutex, portMAX_DELAY);
+            stats.skippedOverlap++;
+            xSemaphoreGive(queueMutex);
+            return false;
+        }
+    }
+    else
+    {
+        task->inFlight++;
+    }
+
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    if (policy == OverlapPolicy::QUEUE && task->queued > 0)
+    {
+        // the queued run has not started yet, it serves this fire as well
+        stats.deferred++;
+        xSemaphoreGive(queueMutex);
+        task->inFlight--;
+        return true;
+    }
+    if (queue.size() >= capacity)
+    {
+        stats.droppedFull++;
+        xSemaphoreGive(queueMutex);
+        task->inFlight--;
+        return false;
+    }
+    task->queued++;
+    queue.push_back({task, task->getPriority(), nextSequence++});
+    std::push_heap(queue.begin(), queue.end(), lowerPriority);
+    stats.submitted++;
+    stats.queueDepth = queue.size();
+    if (stats.queueDepth > stats.highWatermark)
+        stats.highWatermark = stats.queueDepth;
+    xSemaphoreGive(queueMutex);
+
+    xSemaphoreGive(jobsAvailable);
+    return true;
+}
+
+CommandDispatcher::Stats CommandDispatcher::getStats()
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    Stats snapshot = stats;
+    xSemaphoreGive(queueMutex);
+    return snapshot;
+}
+
+void CommandDispatcher::printStats()
+{
+    if (!isRunning())
+    {
+        stream_logger.println("CommandDispatcher: not started");
+        return;
+    }
+    Stats s = getStats();
+    stream_logger.printf("Dispatcher: submitted %u, completed %u, failed %u, dropped (full) %u, "
+                         "skipped (overlap) %u, deferred %u, queue %u/%u, high watermark %u\n",
+                         s.submitted, s.completed, s.failed, s.droppedFull,
+                         s.skippedOverlap, s.deferred, s.queueDepth, (unsigned)capacity, s.highWatermark);
+}
+
+void CommandDispatcher::workerEntry(void *param)
+{
+    static_cast<CommandDispatcher *>(param)->workerLoop();
+}
+
+void CommandDispatcher::workerLoop()
+{
+    while (true)
+    {
+        xSemaphoreTake(jobsAvailable, portMAX_DELAY);
+
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        std::pop_heap(queue.begin(), queue.end(), lowerPriority);
+        std::shared_ptr<ScheduledTask> task = std::move(queue.back().task);
+        queue.pop_back();
+        stats.queueDepth = queue.size();
+        // from now on a fire of a QUEUE task queues the next run instead of folding into this one
+        task->queued--;
+        task->running = true;
+        xSemaphoreGive(queueMutex);
+
+        execute(task);
+        task->running = false;
+        task->inFlight--;
+    }
+}
+
+void CommandDispatcher::execute(const std::shared_ptr<ScheduledTask> &task)
+{
+    std::string taskConfig = task->getConfig();
+    stream_logger.printf("Schedule: %s, command: %s\n", task->getSchedule().c_str(), taskConfig.c_str());
+    bool retCode = commandFunc(taskConfig);
+
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    if (retCode)
+        stats.completed++;
+    else
+        stats.failed++;
+    xSemaphoreGive(queueMutex);
+}
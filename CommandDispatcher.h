@@ -0,0 +1,87 @@
+/**
+ * @file CommandDispatcher.h
+ * @brief A FreeRTOS worker executing the scheduled commands off the scheduler tick.
+ *
+ * The ScheduleManager used to call the command processor synchronously, so a slow command
+ * (loading a path from SPIFFS, for example) delayed every other task firing in the same minute
+ * and blocked the input handling in loop(). Now the tick only submits the fired tasks into
+ * a bounded priority queue and returns; a FreeRTOS worker task drains the queue.
+ *
+ * Ordering: higher ScheduledTask priority first, FIFO among the equal priorities.
+ * Overlap:  every task declares what happens when it fires while its previous run is pending,
+ *           see OverlapPolicy in ScheduledTask.h. SKIP drops the fire, QUEUE folds it into
+ *           the run already queued (or queues one behind the running one), CONCURRENT queues it.
+ * Back-pressure: when the queue is full the fire is dropped and counted, the tick never waits.
+ * Execution: the command function serializes the commands (main.cpp holds a lock shared with
+ *           the loop() input handling), the CommandProcessor is not thread-safe. A second
+ *           worker would only hold a popped job waiting for that lock, so one worker is the default.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "StreamLogger.h"
+#include "ScheduledTask.h"
+
+class CommandDispatcher
+{
+public:
+    using CommandFunc = std::function<bool(std::string &)>;
+
+    struct Stats
+    {
+        uint32_t submitted;      // fires accepted into the queue
+        uint32_t droppedFull;    // fires dropped, the queue was full
+        uint32_t skippedOverlap; // fires dropped by the SKIP policy
+        uint32_t deferred;       // fires folded into the queued run of a QUEUE task
+        uint32_t completed;      // commands executed
+        uint32_t failed;         // commands the processor reported as failed
+        uint16_t queueDepth;     // current queue length
+        uint16_t highWatermark;  // the longest the queue has ever been
+    };
+
+    CommandDispatcher(size_t capacity = 16, uint8_t workers = 1);
+
+    bool begin(CommandFunc func);
+    bool isRunning() const { return !workerHandles.empty(); }
+    bool submit(const std::shared_ptr<ScheduledTask> &task);
+    Stats getStats();
+    void printStats();
+
+private:
+    struct Job
+    {
+        std::shared_ptr<ScheduledTask> task;
+        uint8_t priority;
+        uint32_t sequence;
+    };
+    // std::push_heap keeps the "largest" on top: higher priority, then the older sequence
+    static bool lowerPriority(const Job &a, const Job &b);
+
+    size_t capacity;
+    uint8_t workerCount;
+    CommandFunc commandFunc;
+    std::vector<Job> queue; // binary heap, reserved up front, never reallocates
+    uint32_t nextSequence = 0;
+    Stats stats = {};
+
+    SemaphoreHandle_t queueMutex = nullptr;
+    SemaphoreHandle_t jobsAvailable = nullptr;
+    std::vector<TaskHandle_t> workerHandles;
+
+    static void workerEntry(void *param);
+    void workerLoop();
+    void execute(const std::shared_ptr<ScheduledTask> &task);
+};
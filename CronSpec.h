@@ -0,0 +1,276 @@
+/**
+ * @file CronSpec.h
+ * @brief The compiled form of a cron schedule, one bit per allowed value of every field.
+ *
+ * The parser is constexpr, so the schedules known at the build time are compiled by the compiler:
+ *
+ *     constexpr auto every_evening = "0 21 * * *"_cron;
+ *     schedule_manager.addTask(every_evening, "{\"command\":\"path_player_switch\",\"player\":\"on\"}");
+ *
+ * A malformed literal fails the build with the "malformed cron literal" static_assert, in every
+ * language standard: the literal is a string literal operator template (a GNU extension, GCC and
+ * clang), so the text and the parsed masks are template constants, never evaluated at run time.
+ * The literal keeps the pointer to the text, both live in the flash .rodata.
+ * ScheduledTask parses the runtime schedules (crontab, commands) with the same code.
+ *
+ * Needs C++14 at least (loops in the constexpr functions), build with -std=gnu++14 or later.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#if __cplusplus < 201402L
+#error "CronSpec.h needs C++14 or later, build with -std=gnu++14 (or gnu++17)"
+#endif
+
+struct CronSpec
+{
+    // A classic 5-field schedule fires at second 0, so its seconds mask is just bit 0
+    uint64_t seconds = 1;
+    uint64_t minutes = 0;
+    uint32_t hours = 0;
+    uint32_t daysOfMonth = 0;
+    uint16_t months = 0;
+    uint8_t daysOfWeek = 0;
+    bool valid = true;  // every value is a number in its range, at least 5 fields
+    size_t rest = 0;    // where the text after the schedule fields (the config) starts
+
+    static constexpr uint32_t everyDayOfMonth = 0xFFFFFFFEu; // 1-31
+    static constexpr uint8_t everyDayOfWeek = 0x7F;
+
+    /**
+     * @brief Checks the day fields like cron does: with both the day of the month and the day
+     * of the week restricted, a day matching either one matches ("0 0 13 * 5" is the 13th and
+     * every Friday), otherwise both have to match.
+     * @param dayOfMonth The day of the month, 1-31.
+     * @param month The month, 1-12.
+     * @param weekday The day of the week, 0-6, Sunday = 0.
+     */
+    constexpr bool matchesDay(int dayOfMonth, int month, int weekday) const
+    {
+        if (!((months >> month) & 1))
+            return false;
+        bool dayOfMonthMatches = (daysOfMonth >> dayOfMonth) & 1;
+        bool weekdayMatches = (daysOfWeek >> weekday) & 1;
+        if (daysOfMonth != everyDayOfMonth && daysOfWeek != everyDayOfWeek)
+            return dayOfMonthMatches || weekdayMatches;
+        return dayOfMonthMatches && weekdayMatches;
+    }
+
+    /**
+     * @brief Parses the classic 5-field cron schedule or the Quartz-style 6-field one,
+     * where the leading field holds the seconds. The fields are separated by spaces,
+     * each is a '*' or a comma separated list of numbers. The missing trailing fields
+     * are wildcards, the out of range values are ignored, both clear the valid flag.
+     */
+    static constexpr CronSpec parse(const char *text, size_t length)
+    {
+        CronSpec spec;
+        const char *fields[6] = {};
+        size_t fieldLengths[6] = {};
+        size_t count = 0, pos = 0;
+        while (count < 6 && pos < length)
+        {
+            if (text[pos] == ' ')
+            {
+                ++pos;
+                continue;
+            }
+            size_t end = pos;
+            while (end < length && text[end] != ' ')
+                ++end;
+            // 5-field schedule followed by the config
+            if (count == 5 && !isCronField(text + pos, end - pos))
+                break;
+            fields[count] = text + pos;
+            fieldLengths[count++] = end - pos;
+            pos = end;
+            spec.rest = end < length ? end + 1 : length;
+        }
+        if (count < 5)
+            spec.valid = false;
+
+        size_t i = 0;
+        if (count == 6)
+        {
+            spec.seconds = parseField(fields[i], fieldLengths[i], 0, 59, spec.valid);
+            ++i;
+        }
+        spec.minutes = parseField(fields[i], fieldLengths[i], 0, 59, spec.valid);
+        ++i;
+        spec.hours = (uint32_t)parseField(fields[i], fieldLengths[i], 0, 23, spec.valid);
+        ++i;
+        spec.daysOfMonth = (uint32_t)parseField(fields[i], fieldLengths[i], 1, 31, spec.valid);
+        ++i;
+        spec.months = (uint16_t)parseField(fields[i], fieldLengths[i], 1, 12, spec.valid);
+        ++i;
+        uint64_t weekdays = parseField(fields[i], fieldLengths[i], 0, 7, spec.valid);
+        if (weekdays & 0x80) // 7 is Sunday as well
+            weekdays |= 0x01;
+        spec.daysOfWeek = (uint8_t)(weekdays & 0x7F);
+        return spec;
+    }
+
+    /**
+     * @brief Finds the first matching second at or after the given one, a whole day at a time:
+     * the day fields rule out the days with a few bit tests, the first set bits of the hours,
+     * minutes and seconds masks give the time within the matching day.
+     * @param from The local wall clock second to start at.
+     * @param until The last local wall clock second to consider.
+     * @return The matching local wall clock second, or -1 if there is none up to until.
+     */
+    constexpr int64_t nextMatch(int64_t from, int64_t until) const
+    {
+        const int64_t secondsPerDay = 86400;
+        int64_t day = floorDiv(from, secondsPerDay);
+        int64_t secondOfDay = from - day * secondsPerDay;
+        for (; day * secondsPerDay <= until; ++day, secondOfDay = 0)
+        {
+            int year = 0, month = 0, dayOfMonth = 0;
+            civilFromDays(day, year, month, dayOfMonth);
+            int weekday = (int)((day % 7 + 11) % 7); // 1970-01-01 was a Thursday
+            if (!matchesDay(dayOfMonth, month, weekday))
+                continue;
+
+            int hour = (int)(secondOfDay / 3600);
+            int minute = (int)(secondOfDay % 3600 / 60);
+            int second = (int)(secondOfDay % 60);
+            uint32_t hourMask = hours & (~0u << hour);
+            while (hourMask)
+            {
+                int h = __builtin_ctz(hourMask);
+                hourMask &= hourMask - 1;
+                uint64_t minuteMask = minutes & (h == hour ? ~0ULL << minute : ~0ULL);
+                while (minuteMask)
+                {
+                    int m = __builtin_ctzll(minuteMask);
+                    minuteMask &= minuteMask - 1;
+                    uint64_t secondMask = seconds & (h == hour && m == minute ? ~0ULL << second : ~0ULL);
+                    if (secondMask)
+                    {
+                        int64_t match = day * secondsPerDay + h * 3600 + m * 60 + __builtin_ctzll(secondMask);
+                        return match <= until ? match : -1;
+                    }
+                }
+            }
+        }
+        return -1;
+    }
+
+    static constexpr int64_t floorDiv(int64_t value, int64_t divisor)
+    {
+        return value / divisor - (value % divisor < 0 ? 1 : 0);
+    }
+
+    // Proleptic Gregorian date of the days since 1970-01-01, month 1-12
+    static constexpr void civilFromDays(int64_t days, int &year, int &month, int &day)
+    {
+        days += 719468;
+        const int64_t era = floorDiv(days, 146097);
+        const int64_t dayOfEra = days - era * 146097;
+        const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const int64_t mp = (5 * dayOfYear + 2) / 153;
+        day = (int)(dayOfYear - (153 * mp + 2) / 5 + 1);
+        month = (int)(mp < 10 ? mp + 3 : mp - 9);
+        year = (int)(yearOfEra + era * 400 + (month <= 2 ? 1 : 0));
+    }
+
+    static constexpr bool isCronField(const char *field, size_t length)
+    {
+        if (length == 0)
+            return false;
+        for (size_t i = 0; i < length; ++i)
+            if (!((field[i] >= '0' && field[i] <= '9') || field[i] == '*' || field[i] == ','))
+                return false;
+        return true;
+    }
+
+    // A missing field (nullptr) is a wildcard
+    static constexpr uint64_t parseField(const char *field, size_t length, int minValue, int maxValue, bool &valid)
+    {
+        uint64_t mask = 0;
+        if (field == nullptr || (length == 1 && field[0] == '*'))
+        {
+            // For simplicity, we're not handling steps like */5
+            for (int value = minValue; value <= maxValue; ++value)
+                mask |= 1ULL << value;
+            return mask;
+        }
+        size_t pos = 0;
+        while (pos <= length)
+        {
+            int value = 0, digits = 0;
+            while (pos < length && field[pos] >= '0' && field[pos] <= '9' && digits < 3)
+                value = value * 10 + (field[pos++] - '0'), ++digits;
+            if (digits == 0 || (pos < length && field[pos] != ','))
+            {
+                valid = false;
+                while (pos < length && field[pos] != ',') // skip the garbage up to the next value
+                    ++pos;
+            }
+            else if (value >= minValue && value <= maxValue)
+                mask |= 1ULL << value;
+            else
+                valid = false;
+            ++pos; // the comma
+        }
+        return mask;
+    }
+};
+
+// A schedule literal: the text for listing and saving, the compiled masks for matching
+struct CronLiteral
+{
+    const char *text;
+    size_t length;
+    CronSpec spec;
+};
+
+// The text of a literal and its schedule, parsed once per distinct literal when the template is instantiated
+template <char... Chars>
+struct CronText
+{
+    static constexpr char text[sizeof...(Chars) + 1] = {Chars..., '\0'};
+    static constexpr CronSpec spec = CronSpec::parse(text, sizeof...(Chars));
+    // the literal holds the schedule only, no config after it
+    static_assert(spec.valid && spec.rest == sizeof...(Chars), "malformed cron literal");
+};
+
+#if __cplusplus < 201703L
+// the static constexpr members are not implicitly inline before C++17
+template <char... Chars>
+constexpr char CronText<Chars...>::text[sizeof...(Chars) + 1];
+template <char... Chars>
+constexpr CronSpec CronText<Chars...>::spec;
+#endif
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // the GNU string literal operator template
+template <typename CharT, CharT... Chars>
+constexpr CronLiteral operator""_cron()
+{
+    static_assert(sizeof(CharT) == 1, "a cron literal is a narrow string");
+    return CronLiteral{CronText<Chars...>::text, sizeof...(Chars), CronText<Chars...>::spec};
+}
+#pragma GCC diagnostic pop
+
+// The parser proves itself at the build time
+static_assert("0 21 * * *"_cron.spec.minutes == 1 && "0 21 * * *"_cron.spec.hours == 1u << 21, "");
+static_assert("0 21 * * *"_cron.spec.seconds == 1 && "30 0 21 * * *"_cron.spec.seconds == 1ULL << 30, "");
+static_assert("* * * * 0,7"_cron.spec.daysOfWeek == 1 && "* * * * *"_cron.spec.daysOfWeek == 0x7F, "");
+static_assert("0 0 1,15 * *"_cron.spec.daysOfMonth == ((1u << 1) | (1u << 15)), "");
+static_assert(!CronSpec::parse("0 24 * * *", 10).valid && !CronSpec::parse("0 2 *", 5).valid, "");
+static_assert(CronSpec::parse("0 2 * * * {}", 12).rest == 10, "");
+static_assert("30 0 21 * * *"_cron.spec.nextMatch(1709413200, 1709499600) == 1709413230, "");
+static_assert("0 21 * * 0"_cron.spec.nextMatch(1709413201, 1710000000) == 1709499600, "");
+// 2024-03-02 was a Saturday: the 3rd is a Sunday, "13 or Friday" next matches on Friday the 8th
+static_assert("0 0 13 * 5"_cron.spec.nextMatch(1709337600, 1710000000) == 1709856000, "");
+static_assert("0 0 * * 5"_cron.spec.nextMatch(1709337600, 1710000000) == 1709856000, "");
+static_assert("0 0 2 * *"_cron.spec.nextMatch(1709337600, 1710000000) == 1709337600, "");
@@ -0,0 +1,136 @@
+/**
+ * @file InputChannel.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "InputChannel.h"
+#include "StreamLogger.h"
+
+#include <algorithm>
+
+InputChannel::InputChannel(Stream &channel, Print &echo, Print &reply, const char *name)
+    : InputChannel(channel, echo, reply, name, Limits())
+{
+}
+
+InputChannel::InputChannel(Stream &channel, Print &echo, Print &reply, const char *name, const Limits &limits)
+    : channel(channel), echo(echo), reply(reply), name(name), limits(limits),
+      command_bucket(limits.commands_per_s, limits.command_burst),
+      byte_bucket(limits.bytes_per_s, limits.byte_burst)
+{
+}
+
+void InputChannel::TokenBucket::refill(unsigned long now_ms)
+{
+    uint64_t added = (uint64_t)(now_ms - last_ms) * rate;
+    milli_tokens = (uint32_t)std::min<uint64_t>(capacity, milli_tokens + added);
+    last_ms = now_ms;
+}
+
+bool InputChannel::TokenBucket::take(uint32_t count)
+{
+    if (milli_tokens < count * 1000)
+        return false;
+    milli_tokens -= count * 1000;
+    return true;
+}
+
+uint32_t InputChannel::TokenBucket::ms_until_token() const
+{
+    if (milli_tokens >= 1000 || rate == 0)
+        return 0;
+    return (1000 - milli_tokens + rate - 1) / rate;
+}
+
+/**
+ * @brief Reads the input the budgets allow, never waits for the input.
+ * @param commands Receives the admitted complete lines, without the '\n'.
+ */
+void InputChannel::poll(std::vector<std::string> &commands)
+{
+    unsigned long now = millis();
+    command_bucket.refill(now);
+    byte_bucket.refill(now);
+
+    // Without the byte budget the channel has no flow control, the bytes left in its RX buffer
+    // would overflow it, so the pass reads all of them and refuses the lines over the pass budget
+    bool drain = limits.bytes_per_s == 0;
+    uint8_t lines = 0;
+    while ((drain || lines < limits.commands_per_pass) && channel.available())
+    {
+        if (limits.bytes_per_s != 0 && !byte_bucket.take())
+        {
+            if (!throttled)
+            {
+                // not a busy reply, the pending command is kept and runs later, no resend
+                throttled = true;
+                stats.throttled++;
+                reply.printf("{\"status\":\"throttled\",\"retry_ms\":%u}\n", (unsigned)byte_bucket.ms_until_token());
+            }
+            return;
+        }
+
+        char inChar = (char)channel.read();
+        stats.bytes++;
+        echo.write(inChar); // an echo to see what the clients actually send
+        if (discarding)
+        {
+            discarding = inChar != '\n';
+            continue;
+        }
+        if (inChar == '\n')
+        {
+            admit(commands, lines < limits.commands_per_pass);
+            lines += lines < UINT8_MAX; // the refused lines count as well, the pass stays short under a flood
+        }
+        else if (line.size() >= limits.max_line)
+        {
+            line.clear();
+            discarding = true;
+            stats.too_long++;
+            reply.print("{\"status\":\"too_long\"}\n");
+        }
+        else
+            line += inChar;
+    }
+    // the input is drained, the next throttled period gets its notice again
+    if (!channel.available())
+        throttled = false;
+}
+
+void InputChannel::admit(std::vector<std::string> &commands, bool room_in_pass)
+{
+    // The empty lines and the line break leftovers ("\r") are not commands
+    if (line.length() > 1)
+    {
+        if (!room_in_pass)
+        {
+            // the next pass has room again
+            stats.busy++;
+            reply.printf("{\"status\":\"busy\",\"retry_ms\":%u}\n",
+                         (unsigned)std::max<uint32_t>(portTICK_PERIOD_MS, command_bucket.ms_until_token()));
+        }
+        else if (command_bucket.take())
+        {
+            stats.commands++;
+            commands.push_back(line);
+        }
+        else
+        {
+            stats.busy++;
+            reply.printf("{\"status\":\"busy\",\"retry_ms\":%u}\n", (unsigned)command_bucket.ms_until_token());
+        }
+    }
+    line.clear();
+}
+
+void InputChannel::print_stats()
+{
+    stream_logger.printf("Input %s: %u commands, %u bytes, %u busy, %u throttled, %u too long\n", name,
+                         (unsigned)stats.commands, (unsigned)stats.bytes, (unsigned)stats.busy,
+                         (unsigned)stats.throttled, (unsigned)stats.too_long);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file InputChannel.h
+ * @brief The admission control of the command input, one instance per channel (Serial, BT).
+ *
+ * The loop() handles the input before anything else, so a client flooding the channel would
+ * stretch every loop() pass. The channel reads the input through two token buckets:
+ *
+ * - bytes per second, the bytes over the budget are left in the channel RX buffer;
+ * - commands per second, a complete line over the budget is dropped and answered with
+ *       {"status":"busy","retry_ms":N}
+ *   where N is the time until the next command is admitted, the client shall resend it then.
+ *
+ * A loop() pass takes at most commands_per_pass lines from the channel, the rest waits
+ * for the next pass. When the byte budget runs out while the input is pending, the client
+ * gets one notice for the whole throttled period:
+ *       {"status":"throttled","retry_ms":N}
+ * The bytes stay in the RX buffer and the command in them still runs, so the client shall
+ * not resend anything, only slow down. A line longer than max_line is dropped and answered
+ * with {"status":"too_long"}.
+ *
+ * bytes_per_s = 0 turns the byte budget off, for a link without flow control: the UART
+ * RX buffer is 256 bytes, the bytes left there overflow it and get lost in the middle of a line.
+ * Such a channel is limited by the commands per second and per pass only, a pass reads all
+ * the pending bytes and answers the lines over commands_per_pass busy.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+#include <string>
+#include <vector>
+
+class InputChannel
+{
+public:
+    struct Limits
+    {
+        uint16_t commands_per_s = 10;
+        uint16_t command_burst = 20;
+        uint32_t bytes_per_s = 8192; // 0 for no byte budget
+        uint32_t byte_burst = 2048;
+        uint8_t commands_per_pass = 2;
+        size_t max_line = 4096;
+
+        // The link without flow control, see above
+        static Limits without_byte_budget()
+        {
+            Limits limits;
+            limits.bytes_per_s = 0;
+            return limits;
+        }
+    };
+
+    struct Stats
+    {
+        uint32_t commands;  // admitted
+        uint32_t bytes;     // read from the channel
+        uint32_t busy;      // commands refused, busy replies
+        uint32_t throttled; // the byte budget ran out with the input pending, throttled notices
+        uint32_t too_long;  // overlong lines dropped
+    };
+
+    InputChannel(Stream &channel, Print &echo, Print &reply, const char *name);
+    InputChannel(Stream &channel, Print &echo, Print &reply, const char *name, const Limits &limits);
+
+    void poll(std::vector<std::string> &commands);
+    bool at_line_start() const { return line.empty() && !discarding; }
+    const Stats &get_stats() const { return stats; }
+    void print_stats();
+
+private:
+    // Tokens in 1/1000, refilled by the rate per second times the elapsed milliseconds
+    struct TokenBucket
+    {
+        uint32_t rate;
+        uint32_t capacity;
+        uint32_t milli_tokens;
+        unsigned long last_ms;
+
+        TokenBucket(uint32_t rate, uint32_t burst)
+            : rate(rate), capacity(burst * 1000), milli_tokens(burst * 1000), last_ms(0) {}
+        void refill(unsigned long now_ms);
+        uint32_t available() const { return milli_tokens / 1000; }
+        bool take(uint32_t count = 1);
+        uint32_t ms_until_token() const;
+    };
+
+    Stream &channel;
+    Print &echo;
+    Print &reply;
+    const char *name;
+    Limits limits;
+    TokenBucket command_bucket;
+    TokenBucket byte_bucket;
+    std::string line;
+    bool discarding = false; // the rest of an overlong line
+    bool throttled = false;  // the busy notice has been sent for the current throttled period
+    Stats stats = {};
+
+    void admit(std::vector<std::string> &commands, bool room_in_pass);
+};
@@ -0,0 +1,136 @@
+/**
+ * @file LoopMetrics.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "LoopMetrics.h"
+
+#include <algorithm>
+
+LoopMetrics::LoopMetrics(ScheduleManager &scheduler, StreamLogger &logger, InputChannel &serial_input,
+                         InputChannel &bt_input, unsigned long interval_ms)
+    : scheduler(scheduler), logger(logger), serial_input(serial_input), bt_input(bt_input),
+      interval_ms(interval_ms)
+{
+}
+
+// Call it at the end of setup(), the heap growth is counted from there
+void LoopMetrics::begin()
+{
+    boot_ms = last_report_ms = millis();
+    baseline_free_heap = ESP.getFreeHeap();
+}
+
+void LoopMetrics::pass_finished()
+{
+    loop_us.add(micros() - pass_start_us);
+}
+
+/**
+ * @brief Records a handled command.
+ * @param latency_us From the start of the command handling in the loop() pass to the response.
+ */
+void LoopMetrics::command_done(uint32_t latency_us)
+{
+    commands_total++;
+    command_us.add(latency_us);
+}
+
+void LoopMetrics::report_if_due()
+{
+    if (interval_ms != 0 && millis() - last_report_ms >= interval_ms)
+        report();
+}
+
+/**
+ * @brief Emits the METRICS line, see LoopMetrics.h, and starts the next interval.
+ */
+void LoopMetrics::report()
+{
+    unsigned long now = millis();
+    uint32_t interval_s = std::max<uint32_t>(1, (now - last_report_ms) / 1000);
+    CommandDispatcher::Stats dispatch = scheduler.getDispatchStats();
+    CoalescingWriter::Stats serial_out = logger.serial_out.get_stats();
+    CoalescingWriter::Stats bt_out = logger.bt_out.get_stats();
+    uint32_t free_heap = ESP.getFreeHeap();
+
+    char line[768];
+    snprintf(line, sizeof(line),
+             "METRICS {\"uptime_s\":%u,\"interval_s\":%u,\"commands\":%u,\"commands_total\":%u,\"cmd_per_s\":%.2f,"
+             "\"cmd_us\":{\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u},"
+             "\"loop_us\":{\"p50\":%u,\"p99\":%u,\"max\":%u},"
+             "\"sched_lateness_us\":{\"last\":%u,\"max\":%u},"
+             "\"dispatch\":{\"completed\":%u,\"dropped\":%u,\"queue_max\":%u},"
+             "\"heap\":{\"free\":%u,\"min_free\":%u,\"growth\":%d},"
+             "\"log_bytes\":{\"serial\":%u,\"bt\":%u},"
+             "\"input\":{\"serial_busy\":%u,\"serial_throttled\":%u,\"bt_busy\":%u,\"bt_throttled\":%u}}\n",
+             (unsigned)((now - boot_ms) / 1000), (unsigned)interval_s, (unsigned)command_us.get_count(),
+             (unsigned)commands_total, (double)command_us.get_count() / interval_s,
+             (unsigned)command_us.percentile(50), (unsigned)command_us.percentile(90),
+             (unsigned)command_us.percentile(99), (unsigned)command_us.get_max(),
+             (unsigned)loop_us.percentile(50), (unsigned)loop_us.percentile(99), (unsigned)loop_us.get_max(),
+             (unsigned)scheduler.getLastLatenessUs(), (unsigned)scheduler.getMaxLatenessUs(),
+             (unsigned)dispatch.completed, (unsigned)(dispatch.droppedFull + dispatch.skippedOverlap),
+             (unsigned)dispatch.highWatermark,
+             (unsigned)free_heap, (unsigned)ESP.getMinFreeHeap(), (int)(baseline_free_heap - free_heap),
+             (unsigned)serial_out.bytes, (unsigned)bt_out.bytes,
+             (unsigned)serial_input.get_stats().busy, (unsigned)serial_input.get_stats().throttled,
+             (unsigned)bt_input.get_stats().busy, (unsigned)bt_input.get_stats().throttled);
+    logger.print(line);
+    if (logger.current_channel != LogChannel::BT_CHANNEL) // the logger prints it there already
+        logger.bt_out.print(line);
+
+    command_us.clear();
+    loop_us.clear();
+    last_report_ms = now;
+}
+
+int LoopMetrics::Histogram::index_of(uint32_t value)
+{
+    if (value < 4)
+        return value;
+    int octave = 31 - __builtin_clz(value);
+    return 4 * (octave - 1) + ((value >> (octave - 2)) & 3);
+}
+
+uint32_t LoopMetrics::Histogram::upper_bound_of(int index)
+{
+    if (index < 4)
+        return index;
+    int octave = index / 4 + 1;
+    uint32_t lower = (uint32_t)(4 + index % 4) << (octave - 2);
+    return lower + ((1u << (octave - 2)) - 1);
+}
+
+void LoopMetrics::Histogram::add(uint32_t value)
+{
+    buckets[index_of(value)]++;
+    count++;
+    if (value > max)
+        max = value;
+}
+
+// The upper bound of the bucket holding the percentile, never above the max seen
+uint32_t LoopMetrics::Histogram::percentile(uint32_t per_cent) const
+{
+    if (count == 0)
+        return 0;
+    uint32_t rank = (uint32_t)(((uint64_t)count * per_cent + 99) / 100);
+    uint32_t seen = 0;
+    for (int i = 0; i < Buckets; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::min(upper_bound_of(i), max);
+    }
+    return max;
+}
+
+void LoopMetrics::Histogram::clear()
+{
+    *this = Histogram();
+}
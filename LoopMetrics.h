@@ -0,0 +1,77 @@
+/**
+ * @file LoopMetrics.h
+ * @brief The long running health report of the firmware, for the soak runs over days of uptime.
+ *
+ * The loop() reports the pass durations and the command handling times, the histograms keep
+ * 4 buckets per power of 2 (within 25%) in a fixed array, so the memory never grows.
+ * Every interval one machine-readable line goes to Serial and BT:
+ *
+ *     METRICS {"uptime_s":3600,"interval_s":60,"commands":42,"commands_total":2519,"cmd_per_s":0.7,
+ *              "cmd_us":{"p50":..,"p90":..,"p99":..,"max":..},"loop_us":{"p50":..,"p99":..,"max":..},
+ *              "sched_lateness_us":{"last":..,"max":..},"dispatch":{"completed":..,"dropped":..,"queue_max":..},
+ *              "heap":{"free":..,"min_free":..,"growth":..},"log_bytes":{"serial":..,"bt":..},
+ *              "input":{"serial_busy":..,"serial_throttled":..,"bt_busy":..,"bt_throttled":..}}
+ *
+ * The percentiles cover the interval, the counters since the boot. The heap growth is the free heap
+ * at begin() minus the free heap now. The client soak mode (Program.cs) collects these lines.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+#include "StreamLogger.h"
+#include "ScheduleManager.h"
+#include "InputChannel.h"
+
+class LoopMetrics
+{
+public:
+    LoopMetrics(ScheduleManager &scheduler, StreamLogger &logger, InputChannel &serial_input,
+                InputChannel &bt_input, unsigned long interval_ms = 60000);
+
+    void begin();
+    void pass_started() { pass_start_us = micros(); }
+    void pass_finished();
+    void command_done(uint32_t latency_us);
+    void report_if_due();
+    void report();
+
+private:
+    // 4 buckets per power of 2, the values below 4 have their own
+    class Histogram
+    {
+    public:
+        void add(uint32_t value);
+        uint32_t percentile(uint32_t per_cent) const;
+        uint32_t get_max() const { return max; }
+        uint32_t get_count() const { return count; }
+        void clear();
+
+    private:
+        static const int Buckets = 124; // up to UINT32_MAX
+        uint32_t buckets[Buckets] = {};
+        uint32_t count = 0;
+        uint32_t max = 0;
+
+        static int index_of(uint32_t value);
+        static uint32_t upper_bound_of(int index);
+    };
+
+    ScheduleManager &scheduler;
+    StreamLogger &logger;
+    InputChannel &serial_input;
+    InputChannel &bt_input;
+    unsigned long interval_ms;
+    unsigned long boot_ms = 0;
+    unsigned long last_report_ms = 0;
+    uint32_t baseline_free_heap = 0;
+    uint32_t pass_start_us = 0;
+    uint32_t commands_total = 0;
+    Histogram command_us;
+    Histogram loop_us;
+};
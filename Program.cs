@@ -1,226 +1,689 @@
-﻿// See https://aka.ms/new-console-template for more information
-// Console.WriteLine("Hello, World!");
-// Laser Catnip project - Bluetooth Mobile App simulator for testing ESP32 Bluetooth capabilities
-
-using System.Drawing;
-using System.Net.Sockets;
-using System.Text;
-using InTheHand.Net.Bluetooth;
-using InTheHand.Net.Sockets;
-using Microsoft.VisualBasic;
-using Newtonsoft.Json;
-
-internal class Program
-{
-    private static Thread? readThread = null; // Thread variable
-    private static NetworkStream? stream;
-    private static void Main(string[] args)
-    {
-
-        while (true)
-        {
-            try
-            {
-                BluetoothClient client = new();
-                Console.WriteLine("Scanning for Bluetooth Devices");
-
-                BluetoothDeviceInfo[] devices;// = client.DiscoverDevices().ToArray();
-                try
-                {
-                    //BluetoothClient client = new BluetoothClient();
-                    devices = client.DiscoverDevices().ToArray();
-                    // If no exception is thrown, proceed with the rest of your code...
-                }
-                catch (PlatformNotSupportedException)
-                {
-                    Console.WriteLine("Bluetooth is not supported on this device");
-                    Console.ReadKey();
-                    return;
-                }
-                catch (SocketException ex)
-                {
-                    // This could indicate that Bluetooth is turned off or not functioning properly
-                    Console.WriteLine("An error occurred: " + ex.Message);
-                    Console.WriteLine("Please ensure Bluetooth is turned on.");
-                    Console.ReadKey();
-                    return;
-                }
-                catch (Exception ex)
-                {
-                    // Handle other general exceptions
-                    Console.WriteLine("An unexpected error occurred: " + ex.Message);
-                    Console.ReadKey();
-                    return;
-                }
-
-
-                if (devices.Length == 0)
-                {
-                    Console.WriteLine("No BT Devices discovered, check Bluetooth On.");
-                    Task.Delay(1000);
-                    continue;
-                }
-                else
-                    Console.WriteLine(
-                        string.Join(", ", new string[] { "Devices: " }.Concat(devices.Select(e => e.DeviceName))));
-
-                BluetoothDeviceInfo? esp32Device = devices.FirstOrDefault(d => d.DeviceName == "ESP32Test");
-                if (esp32Device != null)
-                {
-                    string jsonString = JsonConvert.SerializeObject(esp32Device, Formatting.Indented);
-                    Console.WriteLine("Discovered ESP32 controller: \n" + jsonString);
-
-                    //esp32Device.Dump("esp32Device");
-                    client.Connect(esp32Device.DeviceAddress, BluetoothService.SerialPort);
-
-                    stream = client.GetStream();
-
-                    // Start the read thread only if it's not already running
-                    if (readThread == null || !readThread.IsAlive)
-                    {
-                        readThread = new Thread(() =>
-                        {
-                            while (true)
-                            {
-                                if (stream.CanRead)
-                                {
-                                    byte[] myReadBuffer = new byte[1024];
-                                    StringBuilder myCompleteMessage = new();
-                                    int numberOfBytesRead = 0;
-
-                                    do
-                                    {
-                                        try
-                                        {
-                                            numberOfBytesRead = stream.Read(myReadBuffer, 0, myReadBuffer.Length);
-                                            myCompleteMessage.AppendFormat("{0}", Encoding.ASCII.GetString(myReadBuffer, 0, numberOfBytesRead));
-                                        }
-                                        catch { throw; };
-                                    }
-                                    while (stream.DataAvailable);
-
-                                    Console.WriteLine($"ESP32: '{myCompleteMessage}'");
-                                }
-                                Thread.Sleep(100); // Avoids overwhelming the ESP32 and the CPU
-                            }
-                        })
-                        { IsBackground = true };
-                        readThread.Start();
-                    }
-
-                    // Create an anonymous object that matches the required structure.
-                    var commandObject = new
-                    {
-                        command = "set_date_time",
-                        date_time = DateTime.Now.ToString("yyyy-MM-ddTHH:mm:ss")
-                    };
-                    // Convert the anonymous object to a JSON string.
-                    string jsonStringWithTime = JsonConvert.SerializeObject(commandObject) + "\n";
-
-                    if (stream.CanWrite)
-                    {
-                        Console.Write($"Sending to the controller: {jsonStringWithTime}");
-                        byte[] message = Encoding.ASCII.GetBytes(jsonStringWithTime);
-                        stream.Write(message, 0, message.Length);
-                    }
-
-                    // Define a maximum chunk size
-                    const int maxChunkSize = 100; // Adjust this value based on testing
-
-                    while (true) // Continuous loop
-                    {
-                        // Sending data to ESP32
-                        if (stream.CanWrite)
-                        {
-                            Console.WriteLine("Enter command to send (type 'exit' to quit, or 'file' to send a file): ");
-                            string? input = Console.ReadLine();
-                            if (input == "exit") break;
-                            if (input == "file")
-                            {
-                                SendFile();
-                                continue;
-                            }
-                            if (input == null) continue;
-
-                            // Break the input into chunks
-                            for (int i = 0; i < input.Length; i += maxChunkSize)
-                            {
-                                string chunk = input.Substring(i, Math.Min(maxChunkSize, input.Length - i));
-                                byte[] message = Encoding.ASCII.GetBytes(chunk);
-                                stream.Write(message, 0, message.Length);
-                                Thread.Sleep(50); // Small delay between chunks
-                            }
-
-                            // Send a newline character at the end
-                            stream.WriteByte((byte)'\n');
-                        }
-
-                        // Optional: Add a delay to prevent overwhelming the ESP32
-                        Thread.Sleep(10);
-                    }
-
-                    client.Close();
-                }
-            }
-            catch (Exception ex)
-            {
-                Console.WriteLine($"Unrecognized exception {ex.Message}");
-
-                // If an exception occurs, safely abort or finish the read thread
-                if (readThread != null && readThread.IsAlive)
-                {
-                    readThread.Abort();
-                }
-
-                // Reset the thread variable
-                readThread = null;
-            }
-        }
-    }
-    static private byte[] fileImage = new byte[] {
-    2, 0, 0, 0, 16, 0, 0, 0, 152, 31, 189, 94, 140, 1, 0, 0,
-    5, 0, 0, 0, 32, 0, 0, 0, 5, 0, 0, 0, 57, 0, 0, 0, 82, 0, 0, 0,
-    67, 100, 128, 12, 232, 3, 92, 0, 0, 0, 67, 200, 64, 6, 232, 3,
-    150, 32, 8, 232, 3, 130, 64, 11, 232, 3, 102, 0, 0, 0, 67, 230,
-    128, 17, 232, 3, 230, 64, 11, 232, 3, 112, 0, 0, 0, 67, 100, 0,
-    100, 0, 232, 3, 0, 0, 4, 0, 200, 0, 200, 0, 232, 3, 1, 0, 2, 0,
-    130, 0, 24, 1, 232, 3, 0, 0, 1, 0, 180, 0, 150, 0, 232, 3, 1, 0, 0, 0};
-
-    private static void SendFile()
-    {
-        if (stream == null) return;
-
-        var commandObject = new
-        {
-            command = "download_file_image",
-            storage_name = "path_manager_storage.bin",
-            storage_size = fileImage.Length,
-            control_sum = CalculateControlSum()
-        };
-        // Convert the anonymous object to a JSON string.
-        var j_command_string = JsonConvert.SerializeObject(commandObject) + "\n";
-
-        if (stream.CanWrite)
-        {
-            Console.Write($"Sending to the controller: {j_command_string}");
-            byte[] message = Encoding.ASCII.GetBytes(j_command_string);
-            stream.Write(message, 0, message.Length);
-        }
-
-        // stuff the buffer with the json command \n
-        // add a binary trailer to the end of the command, which will be interpreted/stored as a file on the ESP32 side.
-        stream.Write(fileImage, 0, fileImage.Length);
-    }
-
-    static byte CalculateControlSum()
-    {
-        int sum = 0;
-        foreach (byte b in fileImage)
-        {
-            sum += b;
-            sum &= 0xFF;
-        }
-        return (byte)sum;
-    }
-}
-
+﻿// See https://aka.ms/new-console-template for more information
+// Console.WriteLine("Hello, World!");
+// Laser Catnip project - Bluetooth Mobile App simulator for testing ESP32 Bluetooth capabilities
+
+using System.Collections.Concurrent;
+using System.Drawing;
+using System.Net.Sockets;
+using System.Text;
+using InTheHand.Net.Bluetooth;
+using InTheHand.Net.Sockets;
+using Microsoft.VisualBasic;
+using Newtonsoft.Json;
+
+internal class Program
+{
+    private static Thread? readThread = null; // Thread variable
+    private static NetworkStream? stream;
+
+    // Framed bulk transfer, see BulkReceiver.h on the controller side
+    private static volatile bool bulkActive = false;
+    private static readonly BlockingCollection<(byte type, byte[] payload)> bulkReplies = new();
+    private static readonly List<byte> bulkRxBuffer = new();
+
+    // Soak run, see SendSoak()
+    private static volatile bool soakActive = false;
+    private static readonly BlockingCollection<string> soakLines = new();
+    private static readonly ConcurrentQueue<string> soakMetrics = new();
+    private static readonly StringBuilder soakLineBuffer = new();
+    private static void Main(string[] args)
+    {
+
+        while (true)
+        {
+            try
+            {
+                BluetoothClient client = new();
+                Console.WriteLine("Scanning for Bluetooth Devices");
+
+                BluetoothDeviceInfo[] devices;// = client.DiscoverDevices().ToArray();
+                try
+                {
+                    //BluetoothClient client = new BluetoothClient();
+                    devices = client.DiscoverDevices().ToArray();
+                    // If no exception is thrown, proceed with the rest of your code...
+                }
+                catch (PlatformNotSupportedException)
+                {
+                    Console.WriteLine("Bluetooth is not supported on this device");
+                    Console.ReadKey();
+                    return;
+                }
+                catch (SocketException ex)
+                {
+                    // This could indicate that Bluetooth is turned off or not functioning properly
+                    Console.WriteLine("An error occurred: " + ex.Message);
+                    Console.WriteLine("Please ensure Bluetooth is turned on.");
+                    Console.ReadKey();
+                    return;
+                }
+                catch (Exception ex)
+                {
+                    // Handle other general exceptions
+                    Console.WriteLine("An unexpected error occurred: " + ex.Message);
+                    Console.ReadKey();
+                    return;
+                }
+
+
+                if (devices.Length == 0)
+                {
+                    Console.WriteLine("No BT Devices discovered, check Bluetooth On.");
+                    Task.Delay(1000);
+                    continue;
+                }
+                else
+                    Console.WriteLine(
+                        string.Join(", ", new string[] { "Devices: " }.Concat(devices.Select(e => e.DeviceName))));
+
+                BluetoothDeviceInfo? esp32Device = devices.FirstOrDefault(d => d.DeviceName == "ESP32Test");
+                if (esp32Device != null)
+                {
+                    string jsonString = JsonConvert.SerializeObject(esp32Device, Formatting.Indented);
+                    Console.WriteLine("Discovered ESP32 controller: \n" + jsonString);
+
+                    //esp32Device.Dump("esp32Device");
+                    client.Connect(esp32Device.DeviceAddress, BluetoothService.SerialPort);
+
+                    stream = client.GetStream();
+
+                    // Start the read thread only if it's not already running
+                    if (readThread == null || !readThread.IsAlive)
+                    {
+                        readThread = new Thread(() =>
+                        {
+                            while (true)
+                            {
+                                if (stream.CanRead)
+                                {
+                                    byte[] myReadBuffer = new byte[1024];
+                                    StringBuilder myCompleteMessage = new();
+                                    int numberOfBytesRead = 0;
+
+                                    do
+                                    {
+                                        try
+                                        {
+                                            numberOfBytesRead = stream.Read(myReadBuffer, 0, myReadBuffer.Length);
+                                            string text = bulkActive
+                                                ? ExtractBulkFrames(myReadBuffer, numberOfBytesRead)
+                                                : Encoding.ASCII.GetString(myReadBuffer, 0, numberOfBytesRead);
+                                            myCompleteMessage.AppendFormat("{0}", text);
+                                        }
+                                        catch { throw; };
+                                    }
+                                    while (stream.DataAvailable);
+
+                                    if (soakActive)
+                                        CollectSoakLines(myCompleteMessage.ToString());
+                                    else if (myCompleteMessage.Length > 0)
+                                        Console.WriteLine($"ESP32: '{myCompleteMessage}'");
+                                }
+                                // Avoids overwhelming the ESP32 and the CPU, the acks of the bulk transfer
+                                // and the soak latencies can't wait
+                                Thread.Sleep(bulkActive || soakActive ? 1 : 100);
+                            }
+                        })
+                        { IsBackground = true };
+                        readThread.Start();
+                    }
+
+                    // Create an anonymous object that matches the required structure.
+                    var commandObject = new
+                    {
+                        command = "set_date_time",
+                        date_time = ClientTime()
+                    };
+                    // Convert the anonymous object to a JSON string.
+                    string jsonStringWithTime = JsonConvert.SerializeObject(commandObject) + "\n";
+
+                    if (stream.CanWrite)
+                    {
+                        Console.Write($"Sending to the controller: {jsonStringWithTime}");
+                        byte[] message = Encoding.ASCII.GetBytes(jsonStringWithTime);
+                        stream.Write(message, 0, message.Length);
+                    }
+
+                    // Define a maximum chunk size
+                    const int maxChunkSize = 100; // Adjust this value based on testing
+
+                    while (true) // Continuous loop
+                    {
+                        // Sending data to ESP32
+                        if (stream.CanWrite)
+                        {
+                            Console.WriteLine("Enter command to send (type 'exit' to quit, 'file' to send a file, " +
+                                              "'bulk <local path> [<controller path>]' to upload a file, " +
+                                              "or 'soak <trace file>|synthetic [<repeat>] [<gap ms>]' to replay a trace): ");
+                            string? input = Console.ReadLine();
+                            if (input == "exit") break;
+                            if (input == "file")
+                            {
+                                SendFile();
+                                continue;
+                            }
+                            if (input != null && input.StartsWith("bulk "))
+                            {
+                                string[] args2 = input.Split(' ', StringSplitOptions.RemoveEmptyEntries);
+                                if (args2.Length >= 2)
+                                    SendBulk(args2[1], args2.Length >= 3 ? args2[2] : "/" + Path.GetFileName(args2[1]));
+                                continue;
+                            }
+                            if (input != null && input.StartsWith("soak "))
+                            {
+                                string[] args2 = input.Split(' ', StringSplitOptions.RemoveEmptyEntries);
+                                if (args2.Length >= 2)
+                                    SendSoak(args2[1], args2.Length >= 3 ? int.Parse(args2[2]) : 1,
+                                             args2.Length >= 4 ? int.Parse(args2[3]) : 0);
+                                continue;
+                            }
+                            if (input == null) continue;
+
+                            // Break the input into chunks
+                            for (int i = 0; i < input.Length; i += maxChunkSize)
+                            {
+                                string chunk = input.Substring(i, Math.Min(maxChunkSize, input.Length - i));
+                                byte[] message = Encoding.ASCII.GetBytes(chunk);
+                                stream.Write(message, 0, message.Length);
+                                Thread.Sleep(50); // Small delay between chunks
+                            }
+
+                            // Send a newline character at the end
+                            stream.WriteByte((byte)'\n');
+                        }
+
+                        // Optional: Add a delay to prevent overwhelming the ESP32
+                        Thread.Sleep(10);
+                    }
+
+                    client.Close();
+                }
+            }
+            catch (Exception ex)
+            {
+                Console.WriteLine($"Unrecognized exception {ex.Message}");
+
+                // If an exception occurs, safely abort or finish the read thread
+                if (readThread != null && readThread.IsAlive)
+                {
+                    readThread.Abort();
+                }
+
+                // Reset the thread variable
+                readThread = null;
+            }
+        }
+    }
+    static private byte[] fileImage = new byte[] {
+    2, 0, 0, 0, 16, 0, 0, 0, 152, 31, 189, 94, 140, 1, 0, 0,
+    5, 0, 0, 0, 32, 0, 0, 0, 5, 0, 0, 0, 57, 0, 0, 0, 82, 0, 0, 0,
+    67, 100, 128, 12, 232, 3, 92, 0, 0, 0, 67, 200, 64, 6, 232, 3,
+    150, 32, 8, 232, 3, 130, 64, 11, 232, 3, 102, 0, 0, 0, 67, 230,
+    128, 17, 232, 3, 230, 64, 11, 232, 3, 112, 0, 0, 0, 67, 100, 0,
+    100, 0, 232, 3, 0, 0, 4, 0, 200, 0, 200, 0, 232, 3, 1, 0, 2, 0,
+    130, 0, 24, 1, 232, 3, 0, 0, 1, 0, 180, 0, 150, 0, 232, 3, 1, 0, 0, 0};
+
+    private static void SendFile()
+    {
+        if (stream == null) return;
+
+        var commandObject = new
+        {
+            command = "download_file_image",
+            storage_name = "path_manager_storage.bin",
+            storage_size = fileImage.Length,
+            control_sum = CalculateControlSum()
+        };
+        // Convert the anonymous object to a JSON string.
+        var j_command_string = JsonConvert.SerializeObject(commandObject) + "\n";
+
+        if (stream.CanWrite)
+        {
+            Console.Write($"Sending to the controller: {j_command_string}");
+            byte[] message = Encoding.ASCII.GetBytes(j_command_string);
+            stream.Write(message, 0, message.Length);
+        }
+
+        // stuff the buffer with the json command \n
+        // add a binary trailer to the end of the command, which will be interpreted/stored as a file on the ESP32 side.
+        stream.Write(fileImage, 0, fileImage.Length);
+    }
+
+    // Framed bulk transfer: sliding window of chunks, cumulative acks, CRC32 per frame, resumable
+    const byte BulkSync0 = 0xA5, BulkSync1 = 0x5A;
+    const int BulkChunk = 480;          // the controller accepts up to 512 bytes per frame
+    const int BulkAckTimeoutMs = 400;   // no ack that long, go back and resend from the acked offset
+    const int BulkMaxRetries = 20;
+
+    private static void SendBulk(string localPath, string remotePath)
+    {
+        if (stream == null) return;
+
+        byte[] data;
+        try { data = File.ReadAllBytes(localPath); }
+        catch (Exception ex)
+        {
+            Console.WriteLine($"Can't read {localPath}: {ex.Message}");
+            return;
+        }
+        uint fileCrc = Crc32(0, data, 0, data.Length);
+        byte[] name = Encoding.ASCII.GetBytes(remotePath);
+        if (name.Length > 31)
+        {
+            Console.WriteLine("The controller path is limited to 31 characters");
+            return;
+        }
+
+        while (bulkReplies.TryTake(out _)) { }
+        bulkActive = true;
+        var watch = System.Diagnostics.Stopwatch.StartNew();
+        try
+        {
+            byte[] begin = new byte[8 + name.Length];
+            BitConverter.GetBytes((uint)data.Length).CopyTo(begin, 0);
+            BitConverter.GetBytes(fileCrc).CopyTo(begin, 4);
+            name.CopyTo(begin, 8);
+
+            // The ack of the "begin" tells where to resume
+            uint acked = 0;
+            int window = 1;
+            int retries = 0;
+            while (true)
+            {
+                WriteBulkFrame((byte)'B', begin);
+                var reply = WaitBulkReply(BulkAckTimeoutMs * 3);
+                if (reply?.type == (byte)'A')
+                {
+                    acked = BitConverter.ToUInt32(reply.Value.payload, 0);
+                    window = Math.Max(1, (int)BitConverter.ToUInt16(reply.Value.payload, 4));
+                    break;
+                }
+                if (reply?.type == (byte)'F' || ++retries > BulkMaxRetries)
+                {
+                    Console.WriteLine("The controller refused the transfer");
+                    return;
+                }
+            }
+            uint resumedAt = acked;
+            if (acked > 0)
+                Console.WriteLine($"Resuming {remotePath} at {acked} of {data.Length} bytes");
+
+            // Go-back-N: keep the window full, the acks are cumulative
+            uint next = acked;
+            int duplicates = 0;
+            bool goneBack = false; // the duplicate acks of the window in flight don't go back again
+            retries = 0;
+            while (acked < data.Length)
+            {
+                while (next < data.Length && next - acked < window * BulkChunk)
+                {
+                    int length = (int)Math.Min(BulkChunk, data.Length - next);
+                    byte[] payload = new byte[4 + length];
+                    BitConverter.GetBytes(next).CopyTo(payload, 0);
+                    Array.Copy(data, next, payload, 4, length);
+                    WriteBulkFrame((byte)'D', payload);
+                    next += (uint)length;
+                }
+
+                var reply = WaitBulkReply(BulkAckTimeoutMs);
+                if (reply == null)
+                {
+                    if (++retries > BulkMaxRetries)
+                    {
+                        Console.WriteLine($"The controller stopped acking at {acked} bytes, run the same bulk command to resume");
+                        return;
+                    }
+                    next = acked;
+                    continue;
+                }
+                if (reply.Value.type == (byte)'F')
+                {
+                    Console.WriteLine($"The controller aborted the transfer, status {reply.Value.payload[4]}");
+                    return;
+                }
+                if (reply.Value.type != (byte)'A')
+                    continue;
+
+                uint offset = BitConverter.ToUInt32(reply.Value.payload, 0);
+                if (offset > acked)
+                {
+                    acked = offset;
+                    duplicates = 0;
+                    goneBack = false;
+                    retries = 0;
+                    if (next < acked)
+                        next = acked;
+                }
+                else if (!goneBack && ++duplicates >= 2) // a frame got lost or damaged
+                {
+                    next = acked;
+                    duplicates = 0;
+                    goneBack = true;
+                }
+            }
+
+            for (retries = 0; retries <= BulkMaxRetries; ++retries)
+            {
+                WriteBulkFrame((byte)'E', Array.Empty<byte>());
+                var reply = WaitBulkReply(BulkAckTimeoutMs * 3);
+                while (reply?.type == (byte)'A') // the acks of the resent frames still coming
+                    reply = WaitBulkReply(BulkAckTimeoutMs * 3);
+                if (reply?.type == (byte)'F')
+                {
+                    byte status = reply.Value.payload[4];
+                    double seconds = Math.Max(watch.Elapsed.TotalSeconds, 0.001);
+                    Console.WriteLine(status == 0
+                        ? $"Stored {remotePath}, {data.Length - resumedAt} bytes in {seconds:F1} s, {(data.Length - resumedAt) / seconds / 1024:F1} KB/s"
+                        : $"The controller failed to store {remotePath}, status {status}");
+                    return;
+                }
+            }
+            Console.WriteLine("No confirmation from the controller");
+        }
+        finally
+        {
+            bulkActive = false;
+        }
+    }
+
+    private static void WriteBulkFrame(byte type, byte[] payload)
+    {
+        byte[] frame = new byte[2 + 3 + payload.Length + 4];
+        frame[0] = BulkSync0;
+        frame[1] = BulkSync1;
+        frame[2] = type;
+        frame[3] = (byte)(payload.Length & 0xFF);
+        frame[4] = (byte)(payload.Length >> 8);
+        payload.CopyTo(frame, 5);
+        BitConverter.GetBytes(Crc32(0, frame, 2, 3 + payload.Length)).CopyTo(frame, 5 + payload.Length);
+        stream!.Write(frame, 0, frame.Length);
+    }
+
+    private static (byte type, byte[] payload)? WaitBulkReply(int timeoutMs)
+    {
+        return bulkReplies.TryTake(out var reply, timeoutMs) ? reply : null;
+    }
+
+    // Called by the read thread, queues the reply frames and returns the interleaved log text
+    private static string ExtractBulkFrames(byte[] buffer, int count)
+    {
+        StringBuilder text = new();
+        for (int i = 0; i < count; i++)
+            bulkRxBuffer.Add(buffer[i]);
+
+        while (bulkRxBuffer.Count > 0)
+        {
+            if (bulkRxBuffer[0] != BulkSync0)
+            {
+                text.Append((char)bulkRxBuffer[0]);
+                bulkRxBuffer.RemoveAt(0);
+                continue;
+            }
+            if (bulkRxBuffer.Count < 5)
+                break;
+            int length = bulkRxBuffer[3] | (bulkRxBuffer[4] << 8);
+            if (bulkRxBuffer[1] != BulkSync1 || length > 8)
+            {
+                bulkRxBuffer.RemoveAt(0);
+                continue;
+            }
+            if (bulkRxBuffer.Count < 5 + length + 4)
+                break;
+
+            byte[] frame = bulkRxBuffer.GetRange(0, 5 + length + 4).ToArray();
+            if (Crc32(0, frame, 2, 3 + length) == BitConverter.ToUInt32(frame, 5 + length))
+            {
+                bulkReplies.Add((frame[2], frame.Skip(5).Take(length).ToArray()));
+                bulkRxBuffer.RemoveRange(0, frame.Length);
+            }
+            else
+            {
+                bulkRxBuffer.RemoveAt(0);
+            }
+        }
+        return text.ToString();
+    }
+
+    // Soak run: replays a command trace, one command in flight, and records the response latencies.
+    // A trace line is a command, "@<ms> <command>" waits that long before sending it (recorded traces),
+    // the empty lines and the '#' comments are skipped. A "date_time":"now" is replaced by the clock
+    // of this machine as the command is sent, resends included. The controller side is LoopMetrics.h,
+    // its METRICS lines received meanwhile go into the results along with the client figures.
+    const int SoakReplyTimeoutMs = 5000;
+    const int SoakMaxAttempts = 10;  // busy replies before the command counts as refused
+    const string SoakNow = "\"date_time\":\"now\"";
+
+    // The local time with its UTC offset, the controller resolves the repeated DST hour by the offset
+    private static string ClientTime()
+    {
+        return DateTimeOffset.Now.ToString("yyyy-MM-ddTHH:mm:sszzz");
+    }
+
+    private static void SendSoak(string tracePath, int repeat, int gapMs)
+    {
+        if (stream == null) return;
+
+        List<(int delayMs, string command)> trace;
+        try { trace = tracePath == "synthetic" ? SyntheticTrace() : LoadTrace(tracePath); }
+        catch (Exception ex)
+        {
+            Console.WriteLine($"Can't read {tracePath}: {ex.Message}");
+            return;
+        }
+        if (trace.Count == 0)
+        {
+            Console.WriteLine("The trace is empty");
+            return;
+        }
+
+        while (soakLines.TryTake(out _)) { }
+        while (soakMetrics.TryDequeue(out _)) { }
+        lock (soakLineBuffer) soakLineBuffer.Clear();
+        soakActive = true;
+
+        var latencies = new List<double>();
+        int sent = 0, busy = 0, throttled = 0, refused = 0, timeouts = 0, failed = 0;
+        DateTime started = DateTime.Now;
+        var total = System.Diagnostics.Stopwatch.StartNew();
+        try
+        {
+            for (int round = 0; round < repeat; round++)
+            {
+                foreach (var (delayMs, command) in trace)
+                {
+                    Thread.Sleep(delayMs > 0 ? delayMs : gapMs);
+                    var watch = System.Diagnostics.Stopwatch.StartNew();
+                    for (int attempt = 1; ; attempt++)
+                    {
+                        string text = command.Replace(SoakNow, $"\"date_time\":\"{ClientTime()}\"");
+                        byte[] message = Encoding.ASCII.GetBytes(text + "\n");
+                        stream.Write(message, 0, message.Length);
+                        sent++;
+                        string? reply = WaitSoakReply(SoakReplyTimeoutMs);
+                        while (reply != null && reply.Contains("\"throttled\""))
+                        {
+                            // the controller keeps the bytes and runs the command later, no resend
+                            throttled++;
+                            reply = WaitSoakReply(SoakReplyTimeoutMs);
+                        }
+                        if (reply == null)
+                        {
+                            timeouts++;
+                            break;
+                        }
+                        if (reply.Contains("\"too_long\""))
+                        {
+                            refused++;
+                            break;
+                        }
+                        int retryMs = BusyRetryMs(reply);
+                        if (retryMs < 0)
+                        {
+                            latencies.Add(watch.Elapsed.TotalMilliseconds);
+                            if (reply.TrimEnd().EndsWith("returns 0"))
+                                failed++;
+                            break;
+                        }
+                        busy++;
+                        if (attempt == SoakMaxAttempts)
+                        {
+                            refused++;
+                            break;
+                        }
+                        Thread.Sleep(Math.Max(1, retryMs));
+                    }
+                }
+                Console.WriteLine($"Soak round {round + 1} of {repeat}: {latencies.Count} responses, {busy} busy, {throttled} throttled, {timeouts} timeouts");
+            }
+        }
+        finally
+        {
+            soakActive = false;
+        }
+
+        double elapsed = total.Elapsed.TotalSeconds;
+        latencies.Sort();
+        var results = new
+        {
+            trace = tracePath,
+            repeat,
+            started = started.ToString("yyyy-MM-ddTHH:mm:ss"),
+            elapsed_s = Math.Round(elapsed, 1),
+            commands = trace.Count * repeat,
+            sent,
+            responses = latencies.Count,
+            busy,
+            throttled,
+            refused,
+            timeouts,
+            failed,
+            throughput_per_s = Math.Round(latencies.Count / Math.Max(elapsed, 0.001), 2),
+            latency_ms = new
+            {
+                p50 = Percentile(latencies, 50),
+                p90 = Percentile(latencies, 90),
+                p99 = Percentile(latencies, 99),
+                max = latencies.Count > 0 ? Math.Round(latencies[^1], 1) : 0
+            },
+            controller = soakMetrics.Select(line => JsonConvert.DeserializeObject(line)).ToList()
+        };
+        string json = JsonConvert.SerializeObject(results, Formatting.Indented);
+        string resultsPath = $"soak-{started:yyyyMMdd-HHmmss}.json";
+        File.WriteAllText(resultsPath, json);
+        Console.WriteLine(json);
+        Console.WriteLine($"Soak results saved to {resultsPath}");
+    }
+
+    private static List<(int delayMs, string command)> LoadTrace(string path)
+    {
+        var trace = new List<(int delayMs, string command)>();
+        foreach (string raw in File.ReadLines(path))
+        {
+            string line = raw.Trim();
+            if (line.Length == 0 || line.StartsWith("#"))
+                continue;
+            int delayMs = 0;
+            if (line.StartsWith("@"))
+            {
+                int space = line.IndexOf(' ');
+                if (space < 0 || !int.TryParse(line.Substring(1, space - 1), out delayMs))
+                    continue;
+                line = line.Substring(space + 1).Trim();
+            }
+            trace.Add((delayMs, line));
+        }
+        return trace;
+    }
+
+    // The player switches in bursts with a clock sync now and then
+    private static List<(int delayMs, string command)> SyntheticTrace()
+    {
+        var trace = new List<(int delayMs, string command)>();
+        for (int i = 0; i < 100; i++)
+        {
+            if (i % 25 == 0)
+                trace.Add((1000, JsonConvert.SerializeObject(new
+                {
+                    command = "set_date_time",
+                    date_time = "now" // the time of the send, see SendSoak()
+                })));
+            else
+                trace.Add((i % 5 == 0 ? 200 : 0, JsonConvert.SerializeObject(new
+                {
+                    command = "path_player_switch",
+                    player = i % 2 == 0 ? "on" : "off"
+                })));
+        }
+        return trace;
+    }
+
+    // Called by the read thread, splits the text into lines, the METRICS lines are kept aside
+    private static void CollectSoakLines(string text)
+    {
+        lock (soakLineBuffer)
+        {
+            foreach (char c in text)
+            {
+                if (c != '\n')
+                {
+                    soakLineBuffer.Append(c);
+                    continue;
+                }
+                string line = soakLineBuffer.ToString().TrimEnd('\r');
+                soakLineBuffer.Clear();
+                if (line.StartsWith("METRICS "))
+                    soakMetrics.Enqueue(line.Substring("METRICS ".Length));
+                else if (line.Contains("The command processing returns") || line.Contains("\"status\":"))
+                    soakLines.Add(line);
+            }
+        }
+    }
+
+    // The response of the command, or its busy reply
+    private static string? WaitSoakReply(int timeoutMs)
+    {
+        return soakLines.TryTake(out var line, timeoutMs) ? line : null;
+    }
+
+    // The retry_ms of a busy reply, -1 for a response (the throttled notices are not replies)
+    private static int BusyRetryMs(string reply)
+    {
+        if (!reply.Contains("\"status\":"))
+            return -1;
+        var match = System.Text.RegularExpressions.Regex.Match(reply, "\"retry_ms\":(\\d+)");
+        return match.Success ? int.Parse(match.Groups[1].Value) : 0;
+    }
+
+    private static double Percentile(List<double> sorted, int perCent)
+    {
+        if (sorted.Count == 0)
+            return 0;
+        int rank = (int)Math.Ceiling(sorted.Count * perCent / 100.0);
+        return Math.Round(sorted[Math.Max(0, rank - 1)], 1);
+    }
+
+    // CRC32 (IEEE 802.3), the same as BulkReceiver::crc32 on the controller
+    static uint Crc32(uint crc, byte[] data, int offset, int count)
+    {
+        crc = ~crc;
+        for (int i = offset; i < offset + count; i++)
+        {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (0xEDB88320u & (uint)-(int)(crc & 1));
+        }
+        return ~crc;
+    }
+
+    static byte CalculateControlSum()
+    {
+        int sum = 0;
+        foreach (byte b in fileImage)
+        {
+            sum += b;
+            sum &= 0xFF;
+        }
+        return (byte)sum;
+    }
+}
+
@@ -1,150 +1,558 @@
-/**
- * @file ScheduleManager.cpp
- * @author Slava Luchianov
- * @brief
- * @version 0.1
- * @date 2023-12-14
- *
- * @copyright Copyright (c) 2023
- *
- */
-#include "ScheduleManager.h"
-
-ScheduleManager::ScheduleManager(std::string listOfTasks)
-{
-    loadTasks(listOfTasks);
-}
-
-bool ScheduleManager::loadTasks(std::string listOfTasks)
-{
-    std::istringstream stream(listOfTasks);
-    std::string line;
-
-    while (std::getline(stream, line, '|'))
-    {
-        if (!line.empty())
-        {
-            addTask(line);
-        }
-    }
-    return true;
-}
-
-void ScheduleManager::addTask(const std::string &schedule, const std::string &config)
-{
-    if (!config.empty())
-    {
-        tasks.push_back(std::make_unique<ScheduledTask>(schedule, config));
-    }
-}
-
-void ScheduleManager::deleteTask(int index)
-{
-    if (index >= 0 && index < tasks.size())
-    {
-        tasks.erase(tasks.begin() + index);
-    }
-}
-
-void ScheduleManager::deleteAllTasks()
-{
-    tasks.clear();
-}
-
-void ScheduleManager::listTasks()
-{
-    for (int i = 0; i < tasks.size(); ++i)
-        stream_logger.printf("Task #%d, schedule: %s, config: %s\n", i,
-                             tasks[i]->getSchedule().c_str(), tasks[i]->getConfig().c_str());
-}
-
-void ScheduleManager::checkAndRunTasks(
-    std::function<bool(std::string &)> commandProcessorFunc)
-{
-    // stream_logger.println("ScheduleManager::checkAndRunTasks()");
-    static uint8_t schedulerIterations = 0;
-    if (++schedulerIterations % 10 == 0)
-    {
-        stream_logger.printf("S");
-        schedulerIterations = 0;
-    }
-
-    for (auto &task : tasks)
-    {
-        if (task->shouldRunNow())
-        {
-            std::string taskConfig = task->getConfig();
-            stream_logger.printf("Schedule: %s, command: %s\n", task->getSchedule().c_str(), taskConfig.c_str());
-            commandProcessorFunc(taskConfig);
-        }
-    }
-}
-
-void ScheduleManager::saveToSpiffs()
-{
-    stream_logger.println("ScheduleManager::saveToSpiffs()");
-#if false
-    for (auto &task : tasks)
-    {
-        printf((task->getSchedule() + " |" + task->getConfig()).c_str());
-    }
-#else
-    File file = SPIFFS.open("/crontab", FILE_WRITE);
-    if (!file)
-    {
-        stream_logger.println("Failed to open crontab file for writing");
-        return;
-    }
-
-    for (auto &task : tasks)
-    {
-        file.println((task->getSchedule() + " |" + task->getConfig()).c_str());
-    }
-    file.close();
-#endif
-}
-
-void ScheduleManager::restoreFromSpiffs()
-{
-    stream_logger.println("ScheduleManager::restoreFromSpiffs()");
-#if false
-    while (true)
-    {
-        std::string line = "* 2,3 3 4 * Hello";
-        size_t pipeDivider = line.find_last_of('|');
-        std::string schedule = line.substr(0, pipeDivider);
-        std::string config = line.substr(pipeDivider + 1);
-        tasks.push_back(std::make_unique<ScheduledTask>(schedule));
-        break;
-    }
-#else
-    File file = SPIFFS.open("/crontab", FILE_READ);
-    if (!file)
-    {
-        stream_logger.println("Failed to open crontab file for reading");
-        return;
-    }
-    else
-        stream_logger.println("Crontab file open for reading");
-
-    tasks.clear();
-
-    while (file.available())
-    {
-        String line = file.readStringUntil('\n');
-        size_t pipeDivider = line.lastIndexOf('|');
-        std::string schedule = line.substring(0, pipeDivider).c_str();
-        std::string config = line.substring(pipeDivider + 1).c_str();
-        tasks.push_back(std::make_unique<ScheduledTask>(schedule, config));
-        stream_logger.printf("Crontab: %s %s\n", schedule.c_str(), config.c_str());
-    }
-    file.close();
-    this->listTasks();
-#endif
-}
-
-bool ScheduleManager::delayed_setup()
-{
-    restoreFromSpiffs();
-    return true;
-}
+/**
+ * @file ScheduleManager.cpp
+ * @author Slava Luchianov
+ * @brief
+ * @version 0.1
+ * @date 2023-12-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include "ScheduleManager.h"
+#include "ClockHelper.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    // Holds the recursive writer mutex for the scope, the mutators call each other.
+    // The scheduler never takes it, it reads the published snapshot.
+    class WriterLock
+    {
+    public:
+        WriterLock(SemaphoreHandle_t mutex) : mutex(mutex) { xSemaphoreTakeRecursive(mutex, portMAX_DELAY); }
+        ~WriterLock() { xSemaphoreGiveRecursive(mutex); }
+
+    private:
+        SemaphoreHandle_t mutex;
+    };
+
+    // How far the scheduler catches up the missed seconds before it resyncs to the clock
+    const int kMaxCatchUpSeconds = 5;
+}
+
+ScheduleManager::ScheduleManager()
+    : writerMutex(xSemaphoreCreateRecursiveMutex()), agendaMutex(xSemaphoreCreateMutex())
+{
+}
+
+ScheduleManager::ScheduleManager(std::string listOfTasks)
+    : ScheduleManager()
+{
+    loadTasks(listOfTasks);
+}
+
+bool ScheduleManager::loadTasks(std::string listOfTasks)
+{
+    std::istringstream stream(listOfTasks);
+    std::string line;
+
+    while (std::getline(stream, line, '|'))
+    {
+        if (!line.empty())
+        {
+            addTask(line);
+        }
+    }
+    return true;
+}
+
+void ScheduleManager::addTask(const std::string &schedule, const std::string &config)
+{
+    std::shared_ptr<ScheduledTask> task = makeTask(schedule, config);
+    if (task)
+        modifyTasks([&](TaskList &tasks)
+                    { tasks.push_back(task); });
+}
+
+void ScheduleManager::addTask(const std::string &schedule, const std::string &config,
+                              uint8_t priority, OverlapPolicy policy)
+{
+    if (!config.empty())
+    {
+        auto task = std::make_shared<ScheduledTask>(schedule, config, priority, policy);
+        modifyTasks([&](TaskList &tasks)
+                    { tasks.push_back(task); });
+    }
+}
+
+/**
+ * @brief Adds a task of the schedule compiled at the build time, see CronSpec.h.
+ */
+void ScheduleManager::addTask(const CronLiteral &schedule, const std::string &config,
+                              uint8_t priority, OverlapPolicy policy)
+{
+    if (!config.empty())
+    {
+        auto task = std::make_shared<ScheduledTask>(schedule, config, priority, policy);
+        modifyTasks([&](TaskList &tasks)
+                    { tasks.push_back(task); });
+    }
+}
+
+/**
+ * @brief Creates the task of the schedule with the dispatch options, see ScheduleManager.h.
+ * @return The task, or nullptr if the config is empty.
+ */
+std::shared_ptr<ScheduledTask> ScheduleManager::makeTask(const std::string &schedule, const std::string &config)
+{
+    if (config.empty())
+        return nullptr;
+    uint8_t priority = 0;
+    OverlapPolicy policy = OverlapPolicy::SKIP;
+    std::string cronSchedule = extractOptions(schedule, priority, policy);
+    return std::make_shared<ScheduledTask>(cronSchedule, config, priority, policy);
+}
+
+/**
+ * @brief Merges the tasks sending the same config into the first of them, keeps the order.
+ * Only for a list not published yet, the merged tasks get more rules.
+ * @return The number of the tasks merged away.
+ */
+size_t ScheduleManager::mergeDuplicates(TaskList &tasks)
+{
+    std::unordered_multimap<size_t, size_t> byConfig; // the config hash to the kept task index
+    size_t kept = 0;
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        bool merged = false;
+        auto range = byConfig.equal_range(tasks[i]->getConfigHash());
+        for (auto it = range.first; it != range.second && !merged; ++it)
+            merged = tasks[it->second]->mergeRules(*tasks[i]);
+        if (merged)
+            continue;
+        byConfig.emplace(tasks[i]->getConfigHash(), kept);
+        tasks[kept++] = tasks[i];
+    }
+    size_t mergedAway = tasks.size() - kept;
+    tasks.resize(kept);
+    return mergedAway;
+}
+
+/**
+ * @brief Copies the current snapshot, lets the change edit the copy and publishes it.
+ * The scheduler keeps reading the previous snapshot meanwhile, it never waits for the writers.
+ */
+void ScheduleManager::modifyTasks(const std::function<void(TaskList &)> &change)
+{
+    WriterLock lock(writerMutex);
+    TaskList *next = new TaskList(taskTable.snapshot());
+    change(*next);
+    taskTable.publish(next);
+}
+
+/**
+ * @brief Splits the "!option" tokens off the schedule string.
+ * @param schedule The schedule, possibly followed by the dispatch options.
+ * @param priority Receives the !p<N> value, left untouched if there is none.
+ * @param policy Receives the overlap policy, left untouched if there is none.
+ * @return The schedule without the options.
+ */
+std::string ScheduleManager::extractOptions(const std::string &schedule, uint8_t &priority, OverlapPolicy &policy)
+{
+    std::istringstream ss(schedule);
+    std::string token, cronSchedule;
+    while (ss >> token)
+    {
+        if (token == "!skip")
+            policy = OverlapPolicy::SKIP;
+        else if (token == "!queue")
+            policy = OverlapPolicy::QUEUE;
+        else if (token == "!concurrent")
+            policy = OverlapPolicy::CONCURRENT;
+        else if (token.size() > 2 && token[0] == '!' && token[1] == 'p')
+            priority = (uint8_t)std::min(255, std::max(0, atoi(token.c_str() + 2)));
+        else
+            cronSchedule += (cronSchedule.empty() ? "" : " ") + token;
+    }
+    return cronSchedule;
+}
+
+std::string ScheduleManager::formatOptions(const ScheduledTask &task)
+{
+    std::string options;
+    if (task.getPriority() != 0)
+        options += " !p" + std::to_string(task.getPriority());
+    if (task.getOverlapPolicy() == OverlapPolicy::QUEUE)
+        options += " !queue";
+    else if (task.getOverlapPolicy() == OverlapPolicy::CONCURRENT)
+        options += " !concurrent";
+    return options;
+}
+
+void ScheduleManager::deleteTask(int index)
+{
+    modifyTasks([&](TaskList &tasks)
+                {
+        if (index >= 0 && index < tasks.size())
+        {
+            tasks.erase(tasks.begin() + index);
+        } });
+}
+
+void ScheduleManager::deleteAllTasks()
+{
+    modifyTasks([](TaskList &tasks)
+                { tasks.clear(); });
+}
+
+void ScheduleManager::listTasks()
+{
+    WriterLock lock(writerMutex);
+    const TaskList &tasks = taskTable.snapshot();
+    for (int i = 0; i < tasks.size(); ++i)
+        stream_logger.printf("Task #%d, schedule: %s%s, config: %s\n", i,
+                             tasks[i]->getSchedule().c_str(), formatOptions(*tasks[i]).c_str(),
+                             tasks[i]->getConfig().c_str());
+}
+
+/**
+ * @brief Streams the fires of the tasks within the range into the sink, in time order.
+ * The same second fires in the task order. The run state of the tasks is not touched.
+ * @param localFrom The first local wall clock second of the range.
+ * @param localTo The last local wall clock second of the range, inclusive.
+ * @param commandFilter Only the tasks whose config contains it, empty for all the tasks.
+ * @param sink Receives the fires, returns false to stop.
+ * @return The number of the fires passed to the sink.
+ */
+size_t ScheduleManager::agenda(std::time_t localFrom, std::time_t localTo, const std::string &commandFilter,
+                               const AgendaSink &sink)
+{
+    // The snapshot is read in place, the sink may take long (BT) and shall not hold the writers.
+    // The agenda reader slot is one, the agendas take turns.
+    xSemaphoreTake(agendaMutex, portMAX_DELAY);
+    TaskTable::ReadGuard tasks(taskTable, TaskTable::AGENDA_READER);
+
+    // the next fire of every task, the earliest on the top
+    using NextFire = std::pair<std::time_t, int>;
+    std::vector<NextFire> heap;
+    heap.reserve(tasks->size());
+    for (int i = 0; i < tasks->size(); ++i)
+    {
+        if (!commandFilter.empty() && (*tasks)[i]->getConfig().find(commandFilter) == std::string::npos)
+            continue;
+        std::time_t next = (*tasks)[i]->nextRunAfter(localFrom, localTo);
+        if (next >= 0)
+            heap.emplace_back(next, i);
+    }
+    std::make_heap(heap.begin(), heap.end(), std::greater<NextFire>());
+
+    size_t count = 0;
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<NextFire>());
+        NextFire fire = heap.back();
+        if (!sink(fire.first, fire.second, *(*tasks)[fire.second]))
+            break;
+        ++count;
+        std::time_t next = fire.first < localTo ? (*tasks)[fire.second]->nextRunAfter(fire.first + 1, localTo) : -1;
+        if (next >= 0)
+        {
+            heap.back().first = next;
+            std::push_heap(heap.begin(), heap.end(), std::greater<NextFire>());
+        }
+        else
+            heap.pop_back();
+    }
+    xSemaphoreGive(agendaMutex);
+    return count;
+}
+
+/**
+ * @brief Prints the upcoming fires from now on, see agenda().
+ * @param hours How far ahead to look.
+ * @param commandFilter Only the tasks whose config contains it, empty for all the tasks.
+ * @param maxEntries The output limit, the agenda stops there.
+ */
+void ScheduleManager::printAgenda(int hours, const std::string &commandFilter, size_t maxEntries)
+{
+    std::time_t now = runtime_clock_helper.utc_to_local(std::time(nullptr));
+    size_t printed = 0;
+    agenda(now, now + (std::time_t)hours * 3600 - 1, commandFilter,
+           [&](std::time_t localWall, int taskIndex, const ScheduledTask &task)
+           {
+               if (printed >= maxEntries)
+                   return false;
+               ++printed;
+               std::tm ltm;
+               gmtime_r(&localWall, &ltm);
+               char when[24];
+               strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &ltm);
+               stream_logger.printf("Agenda: %s task #%d, config: %s\n", when, taskIndex,
+                                    task.getConfig().c_str());
+               return true;
+           });
+    stream_logger.printf("Agenda: %u fires listed for the next %d hours\n", (unsigned)printed, hours);
+}
+
+/**
+ * @brief Starts the worker pool and the scheduler task.
+ * @param commandProcessorFunc The command processor entry point executing the task configs.
+ * @return True if both are running.
+ */
+bool ScheduleManager::startScheduler(std::function<bool(std::string &)> commandProcessorFunc)
+{
+    if (!dispatcher.begin(commandProcessorFunc))
+        return false;
+    // Above the loop() priority, the boundary wake up shall not wait for the input handling
+    if (xTaskCreate(schedulerEntry, "scheduler", 4096, this, 2, nullptr) != pdPASS)
+    {
+        stream_logger.println("ScheduleManager: failed to start the scheduler task");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluates the tasks for the current second, for the callers driving the scheduler manually.
+ * Not to be mixed with startScheduler(), the task run state has one evaluating reader at a time.
+ */
+void ScheduleManager::checkAndRunTasks(
+    std::function<bool(std::string &)> commandProcessorFunc)
+{
+    // The workers are started with the first tick, they need the command processor entry point
+    if (!dispatcher.isRunning() && !dispatcher.begin(commandProcessorFunc))
+        return;
+
+    runTasksAt(std::time(nullptr), TaskTable::MANUAL_READER);
+}
+
+/**
+ * @brief Evaluates the tasks against the local wall clock of the given UTC second.
+ *
+ * The jumps of the wall clock (DST switches, clock steps) are served by wallClock,
+ * see WallClockSequence.h: the skipped times fire once, the repeated times do not fire again.
+ * The skipped times are replayed in the time order, and a command fired again later in the
+ * skipped range supersedes its earlier fire, so a laser switched on and off within the range ends off.
+ */
+void ScheduleManager::runTasksAt(std::time_t when, TaskTable::ReaderSlot reader)
+{
+    // stream_logger.println("ScheduleManager::runTasksAt()");
+    if (++schedulerIterations % 10 == 0)
+    {
+        stream_logger.printf("S");
+        schedulerIterations = 0;
+    }
+
+    std::time_t local = runtime_clock_helper.utc_to_local(when);
+    std::time_t gapFrom;
+    if (!wallClock.advance(when, local, gapFrom))
+        return; // these wall clock times have been served already
+
+    // Wait-free, the writers publish a new snapshot instead of changing this one
+    TaskTable::ReadGuard tasks(taskTable, reader);
+    firedThisTick.clear();
+    // The tick only queues the fired tasks, the worker pool executes them
+    if (gapFrom == 0)
+    {
+        for (auto &task : *tasks)
+            if (task->shouldRunAt(local))
+                dispatchFire(task);
+        return;
+    }
+
+    // The last fire of every task within the skipped range and this second, in the time order
+    catchUpFires.clear();
+    for (size_t i = 0; i < tasks->size(); ++i)
+    {
+        ScheduledTask &task = *(*tasks)[i];
+        std::time_t at = task.shouldRunAt(local) ? local : task.lastRunWithin(gapFrom, local - 1);
+        if (at >= 0)
+            catchUpFires.push_back({at, i});
+    }
+    // the fires of the same second keep the table order
+    std::stable_sort(catchUpFires.begin(), catchUpFires.end(),
+                     [](const CatchUpFire &a, const CatchUpFire &b)
+                     { return a.at < b.at; });
+    for (size_t i = 0; i < catchUpFires.size(); ++i)
+    {
+        const std::shared_ptr<ScheduledTask> &task = (*tasks)[catchUpFires[i].task];
+        std::string command = commandOf(task->getConfig());
+        bool superseded = false;
+        for (size_t later = i + 1; later < catchUpFires.size() && !superseded; ++later)
+            superseded = catchUpFires[later].at > catchUpFires[i].at &&
+                         commandOf((*tasks)[catchUpFires[later].task]->getConfig()) == command;
+        if (superseded)
+        {
+            supersededFires++;
+            stream_logger.printf("Schedule: %s, catch-up fire superseded by a later one: %s\n",
+                                 task->getSchedule().c_str(), task->getConfig().c_str());
+            continue;
+        }
+        dispatchFire(task);
+    }
+}
+
+/**
+ * @brief Hands a fired task over to the dispatcher, unless its command went out in this tick already.
+ */
+void ScheduleManager::dispatchFire(const std::shared_ptr<ScheduledTask> &task)
+{
+    // the same command sent by another task in this tick already
+    for (const ScheduledTask *fired : firedThisTick)
+        if (fired->getConfigHash() == task->getConfigHash() && fired->getConfig() == task->getConfig())
+        {
+            dedupedDispatches++;
+            return;
+        }
+    // a dropped fire (skipped overlap, full queue) does not make the same command of the
+    // other tasks a duplicate, one of them may still get it through
+    if (dispatcher.submit(task))
+        firedThisTick.push_back(task.get());
+    else
+        stream_logger.printf("Schedule: %s, command dropped: %s\n",
+                             task->getSchedule().c_str(), task->getConfig().c_str());
+}
+
+/**
+ * @brief The "command" of the JSON config, the whole config if it has none.
+ * The fires of one command override each other, e.g. the player switched on and off.
+ */
+std::string ScheduleManager::commandOf(const std::string &config)
+{
+    const std::string key = "\"command\"";
+    size_t at = config.find(key);
+    if (at == std::string::npos)
+        return config;
+    size_t open = config.find('"', config.find(':', at + key.size()));
+    size_t close = open == std::string::npos ? open : config.find('"', open + 1);
+    if (close == std::string::npos)
+        return config;
+    return config.substr(open + 1, close - open - 1);
+}
+
+void ScheduleManager::schedulerEntry(void *param)
+{
+    static_cast<ScheduleManager *>(param)->schedulerLoop();
+}
+
+/**
+ * @brief Sleeps until the next second boundary and evaluates the tasks for that second.
+ *
+ * The wake up is computed from the wall clock instead of polling, so the dispatch lands
+ * within a tick after the boundary. The missed seconds are caught up (a busy second,
+ * a higher priority task hogging the core), unless the clock has been adjusted, then it resyncs
+ * and runTasksAt() fires the skipped wall clock times once.
+ */
+void ScheduleManager::schedulerLoop()
+{
+    const int64_t usPerTick = portTICK_PERIOD_MS * 1000;
+    std::time_t next = 0;
+    while (true)
+    {
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        if (next == 0 || next > now.tv_sec + 1 || next < now.tv_sec - kMaxCatchUpSeconds)
+            next = now.tv_sec + 1;
+
+        int64_t waitUs = (int64_t)(next - now.tv_sec) * 1000000 - now.tv_usec;
+        if (waitUs > 0)
+        {
+            // round up, the wake up shall never come before the boundary
+            vTaskDelay((waitUs + usPerTick - 1) / usPerTick);
+            continue;
+        }
+
+        lastLatenessUs = (uint32_t)std::min<int64_t>(-waitUs, UINT32_MAX);
+        if (lastLatenessUs > maxLatenessUs)
+            maxLatenessUs = lastLatenessUs;
+
+        runTasksAt(next++, TaskTable::SCHEDULER_READER);
+    }
+}
+
+void ScheduleManager::printSchedulerStats()
+{
+    stream_logger.printf("Scheduler: dispatch lateness last %u us, max %u us\n",
+                         lastLatenessUs, maxLatenessUs);
+    stream_logger.printf("Scheduler: %u crontab lines merged into the other tasks, %u duplicate dispatches saved\n",
+                         mergedTasks, dedupedDispatches);
+    stream_logger.printf("Scheduler: %u catch-up fires superseded by a later fire of the command\n",
+                         supersededFires);
+    dispatcher.printStats();
+}
+
+void ScheduleManager::saveToSpiffs()
+{
+    stream_logger.println("ScheduleManager::saveToSpiffs()");
+    WriterLock lock(writerMutex);
+    const TaskList &tasks = taskTable.snapshot();
+#if false
+    for (auto &task : tasks)
+    {
+        printf((task->getSchedule() + " |" + task->getConfig()).c_str());
+    }
+#else
+    File file = SPIFFS.open("/crontab", FILE_WRITE);
+    if (!file)
+    {
+        stream_logger.println("Failed to open crontab file for writing");
+        return;
+    }
+
+    // One line per rule, the restore merges them again
+    for (auto &task : tasks)
+    {
+        for (size_t rule = 0; rule < task->getRuleCount(); ++rule)
+            file.println((task->getRuleSchedule(rule) + formatOptions(*task) + " |" + task->getConfig()).c_str());
+    }
+    file.close();
+#endif
+}
+
+void ScheduleManager::restoreFromSpiffs()
+{
+    stream_logger.println("ScheduleManager::restoreFromSpiffs()");
+#if false
+    while (true)
+    {
+        std::string line = "* 2,3 3 4 * Hello";
+        size_t pipeDivider = line.find_last_of('|');
+        std::string schedule = line.substr(0, pipeDivider);
+        std::string config = line.substr(pipeDivider + 1);
+        tasks.push_back(std::make_unique<ScheduledTask>(schedule));
+        break;
+    }
+#else
+    File file = SPIFFS.open("/crontab", FILE_READ);
+    if (!file)
+    {
+        stream_logger.println("Failed to open crontab file for reading");
+        return;
+    }
+    else
+        stream_logger.println("Crontab file open for reading");
+
+    // The whole crontab becomes one snapshot, the scheduler never sees it half loaded
+    TaskList *restored = new TaskList();
+    while (file.available())
+    {
+        String line = file.readStringUntil('\n');
+        line.trim(); // println() ends the line with "\r\n", the '\r' would stick to the config
+        size_t pipeDivider = line.lastIndexOf('|');
+        std::string schedule = line.substring(0, pipeDivider).c_str();
+        std::string config = line.substring(pipeDivider + 1).c_str();
+        std::shared_ptr<ScheduledTask> task = makeTask(schedule, config);
+        if (task)
+            restored->push_back(task);
+        stream_logger.printf("Crontab: %s %s\n", schedule.c_str(), config.c_str());
+    }
+    file.close();
+    size_t merged = mergeDuplicates(*restored);
+    if (merged != 0)
+        stream_logger.printf("Crontab: %u lines merged into the tasks sending the same config\n", (unsigned)merged);
+    {
+        WriterLock lock(writerMutex);
+        mergedTasks = merged;
+        taskTable.publish(restored);
+    }
+    this->listTasks();
+#endif
+}
+
+bool ScheduleManager::delayed_setup()
+{
+    restoreFromSpiffs();
+    return true;
+}
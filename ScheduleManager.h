@@ -1,82 +1,183 @@
-/**
- * @file ScheduleManager.h
- * @author Slava Luchianov
- * @brief This file contains a scheduler related functionality
- * It allows storing the information when the system shall start working
- * and when it should stop working.
- * The scheduling information is stored in the flash memory to survive over the power outage
- * When the system is rebooted or reset, the scheduler inspects the flash memory
- * trying to restore its content. After it retreives the rechedule records, it starts the tasks
- * to start and stop the playing of the paths.
- *
- * We are going to use a Unix cron-style scheduling system for our project. Cron is a time-based job scheduler in Unix-like operating systems, and it uses a specific format to represent different time intervals. The format consists of five fields, representing different units of time, and it looks like this:
-
-* * * * *
-| | | | |
-| | | | +---- Day of the Week   (0 - 7) [0 and 7 are Sunday]
-| | | +------ Month of the Year (1 - 12)
-| | +-------- Day of the Month  (1 - 31)
-| +---------- Hour              (0 - 23)
-+------------ Minute            (0 - 59)
-
-Each field can have:
-
-    A number in its range.
-    A star * which represents all possible values for that field.
-    A list of numbers or ranges separated by commas, e.g., 1,3,5 or 1-3.
-        We will not support the ranges
-    Increments like *<backshash>15 in the minutes field to represent every 15 minutes.
-        We will probably not support the "every n minutes" format
-
-Here's a quick breakdown:
-
-    5 * * * * would mean "run at 5 minutes past every hour."
-    0 2 * * * means "run at 2:00 AM every day."
-    0 0 * * 0 means "run at midnight on every Sunday."
-    *<backshash>10 * * * * means "run every 10 minutes."
- *
- * It should probably support the Command Processor commands (TBD)
- * cmd_add_time_range(start_time, end_time)
- * cmd_list_time_ranges() - returns a list of ranges
- * cmd_delete_time_range(n)
- * Or maybe some other strategies.
- *
- * @version 0.1
- * @date 2023-11-11
- *
- * @copyright Copyright (c) 2023
- *
- */
-
-#pragma once
-#include <vector>
-#include <memory>
-#include <iostream>
-
-#include "SPIFFS.h"
-
-#include "StreamLogger.h"
-#include "AlgoHelper.h"
-#include "ScheduledTask.h"
-
-class ScheduleManager
-{
-public:
-    ScheduleManager(){};
-    ScheduleManager(std::string listOfTasks);
-
-    bool loadTasks(std::string listOfTasks);
-    void addTask(const std::string &schedule, const std::string &config = "");
-    void deleteTask(int index);
-    void deleteAllTasks();
-    void listTasks();
-    void checkAndRunTasks(std::function<bool(std::string &)> commandProcessorFunc);
-    void saveToSpiffs();
-    void restoreFromSpiffs();
-    bool delayed_setup();
-
-private:
-    std::vector<std::unique_ptr<ScheduledTask>> tasks;
-};
-
+/**
+ * @file ScheduleManager.h
+ * @author Slava Luchianov
+ * @brief This file contains a scheduler related functionality
+ * It allows storing the information when the system shall start working
+ * and when it should stop working.
+ * The scheduling information is stored in the flash memory to survive over the power outage
+ * When the system is rebooted or reset, the scheduler inspects the flash memory
+ * trying to restore its content. After it retreives the rechedule records, it starts the tasks
+ * to start and stop the playing of the paths.
+ *
+ * We are going to use a Unix cron-style scheduling system for our project. Cron is a time-based job scheduler in Unix-like operating systems, and it uses a specific format to represent different time intervals. The format consists of five fields, representing different units of time, and it looks like this:
+
+* * * * *
+| | | | |
+| | | | +---- Day of the Week   (0 - 7) [0 and 7 are Sunday]
+| | | +------ Month of the Year (1 - 12)
+| | +-------- Day of the Month  (1 - 31)
+| +---------- Hour              (0 - 23)
++------------ Minute            (0 - 59)
+
+Each field can have:
+
+    A number in its range.
+    A star * which represents all possible values for that field.
+    A list of numbers or ranges separated by commas, e.g., 1,3,5 or 1-3.
+        We will not support the ranges
+    Increments like *<backshash>15 in the minutes field to represent every 15 minutes.
+        We will probably not support the "every n minutes" format
+
+An optional leading sixth field (Quartz-style) adds the seconds (0 - 59), a 5-field schedule fires
+at the second 0. The scheduler runs in its own FreeRTOS task, sleeps until the next second
+boundary and evaluates the tasks there, so the fires land within a millisecond or two of it.
+
+    30 0 21 * * * means "run at 21:00:30 every day."
+
+The schedules follow the local wall clock of the time zone configured in the ClockHelper.
+When the clocks spring forward, a task scheduled in the skipped hour runs once right after
+the switch, the skipped fires go out in the time order and only the last fire of a command in
+the skipped range is kept (the player switched on, then off, ends off). When they fall back, the repeated hour is not evaluated twice, a 1:30 task runs once.
+A step of the clock (an RTC sync) is handled the same way, up to an hour back, see WallClockSequence.h.
+
+Here's a quick breakdown:
+
+    5 * * * * would mean "run at 5 minutes past every hour."
+    0 2 * * * means "run at 2:00 AM every day."
+    0 0 * * 0 means "run at midnight on every Sunday."
+    0 0 13 * 5 means "run at midnight on the 13th and on every Friday", like cron: with both day
+        fields restricted either one matches.
+    *<backshash>10 * * * * means "run every 10 minutes."
+ *
+ * It should probably support the Command Processor commands (TBD)
+ * cmd_add_time_range(start_time, end_time)
+ * cmd_list_time_ranges() - returns a list of ranges
+ * cmd_delete_time_range(n)
+ * Or maybe some other strategies.
+ *
+ * The fired tasks are not executed by the scheduler tick, they are handed over to the
+ * CommandDispatcher worker pool. A task may carry its dispatch options after the cron fields,
+ * they are persisted in the crontab the same way:
+ *
+ *     0 2 * * * !p3 !queue |{"command":"path_player_switch","player":"on"}
+ *
+ *     !p<N>        priority 0..255, the higher runs first (default 0)
+ *     !skip        skip the fire while the previous run is pending (default)
+ *     !queue       run again after the previous run, the fires meanwhile fold into that one run
+ *     !concurrent  queue every fire even while the previous run is pending
+ *
+ * The crontab lines sending the same config with the same options are merged into one task
+ * with several rules when the crontab is restored, the task is listed (and deleted) as one entry
+ * and saved back as one line per rule. Within a tick, the same config is dispatched once
+ * even if several tasks fire with it.
+ *
+ * The agenda lists the upcoming fires of all the tasks merged in time order, in the local
+ * wall clock. Every task yields its next fire from the schedule bitmasks a day at a time,
+ * a heap keyed by the next fire merges them, so the memory is one heap entry per task
+ * and the fires stream out one by one. The DST gaps and repeats are not reflected there.
+ * The agenda reads the published snapshot in place through its own reader slot, it never holds
+ * the writers; the snapshots they retire meanwhile are reclaimed once the agenda is done.
+ *
+ * @version 0.1
+ * @date 2023-11-11
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <sys/time.h>
+
+#include "SPIFFS.h"
+
+#include "StreamLogger.h"
+#include "AlgoHelper.h"
+#include "ScheduledTask.h"
+#include "CommandDispatcher.h"
+#include "TaskTable.h"
+#include "WallClockSequence.h"
+
+class ScheduleManager
+{
+public:
+    ScheduleManager();
+    ScheduleManager(std::string listOfTasks);
+
+    bool loadTasks(std::string listOfTasks);
+    void addTask(const std::string &schedule, const std::string &config = "");
+    void addTask(const std::string &schedule, const std::string &config,
+                 uint8_t priority, OverlapPolicy policy);
+    void addTask(const CronLiteral &schedule, const std::string &config,
+                 uint8_t priority = 0, OverlapPolicy policy = OverlapPolicy::SKIP);
+    void deleteTask(int index);
+    void deleteAllTasks();
+    void listTasks();
+
+    // Receives the fires in time order, returns false to stop the agenda
+    using AgendaSink = std::function<bool(std::time_t localWall, int taskIndex, const ScheduledTask &task)>;
+    size_t agenda(std::time_t localFrom, std::time_t localTo, const std::string &commandFilter,
+                  const AgendaSink &sink);
+    void printAgenda(int hours, const std::string &commandFilter = "", size_t maxEntries = 100);
+    bool startScheduler(std::function<bool(std::string &)> commandProcessorFunc);
+    void checkAndRunTasks(std::function<bool(std::string &)> commandProcessorFunc);
+    void printSchedulerStats();
+    uint32_t getLastLatenessUs() const { return lastLatenessUs; }
+    uint32_t getMaxLatenessUs() const { return maxLatenessUs; }
+    uint32_t getDedupedDispatches() const { return dedupedDispatches; }
+    uint32_t getSupersededFires() const { return supersededFires; }
+    CommandDispatcher::Stats getDispatchStats() { return dispatcher.getStats(); }
+    void saveToSpiffs();
+    void restoreFromSpiffs();
+    bool delayed_setup();
+
+private:
+    // the copy-on-write snapshots of the tasks, the tasks are shared with the dispatcher queue,
+    // a task deleted while its command is pending stays alive
+    TaskTable taskTable;
+    CommandDispatcher dispatcher;
+    // serializes the writers (and the readers outside the scheduler), the scheduler never takes it
+    SemaphoreHandle_t writerMutex = nullptr;
+    // serializes the agendas, they share the agenda reader slot of the task table
+    SemaphoreHandle_t agendaMutex = nullptr;
+
+    // dispatch lateness against the second boundary, in microseconds
+    uint32_t lastLatenessUs = 0;
+    uint32_t maxLatenessUs = 0;
+
+    // the crontab lines merged into the other tasks, the duplicate fires not dispatched
+    uint32_t mergedTasks = 0;
+    uint32_t dedupedDispatches = 0;
+    // the catch-up fires of the skipped range superseded by a later fire of the same command
+    uint32_t supersededFires = 0;
+    // the tasks dispatched within the current tick, to skip the duplicate commands
+    std::vector<const ScheduledTask *> firedThisTick;
+    // the fires of a tick after a wall clock jump, the second and the index in the snapshot
+    struct CatchUpFire
+    {
+        std::time_t at;
+        size_t task;
+    };
+    std::vector<CatchUpFire> catchUpFires;
+
+    // the evaluated seconds on the local wall clock, the DST switches and the clock steps
+    WallClockSequence wallClock;
+    // the evaluations since the last progress dot, owned by the evaluating reader like wallClock
+    uint8_t schedulerIterations = 0;
+
+    void runTasksAt(std::time_t when, TaskTable::ReaderSlot reader);
+    void dispatchFire(const std::shared_ptr<ScheduledTask> &task);
+    static std::string commandOf(const std::string &config);
+    void modifyTasks(const std::function<void(TaskList &)> &change);
+    static std::shared_ptr<ScheduledTask> makeTask(const std::string &schedule, const std::string &config);
+    static size_t mergeDuplicates(TaskList &tasks);
+    static void schedulerEntry(void *param);
+    void schedulerLoop();
+
+    static std::string extractOptions(const std::string &schedule, uint8_t &priority, OverlapPolicy &policy);
+    static std::string formatOptions(const ScheduledTask &task);
+};
+
 extern ScheduleManager schedule_manager;
\ No newline at end of file
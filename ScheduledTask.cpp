@@ -1,152 +1,176 @@
-/**
- * @file ScheduledTask.cpp
- * @author Slava Luchianov
- * @brief
- * @version 0.1
- * @date 2023-12-08
- *
- * @copyright Copyright (c) 2023
- *
- */
-#include "ScheduledTask.h"
-
-ScheduledTask::ScheduledTask(const std::string &schedule, const std::string &config)
-    : origSchedule(schedule), extraConfig(config)
-{
-    parseSchedule(schedule);
-}
-
-bool ScheduledTask::shouldRunNow()
-{
-    std::time_t now = std::time(nullptr);
-    std::tm &ltm = *std::localtime(&now);
-
-    if (matches(ltm.tm_min, minutes) &&
-        matches(ltm.tm_hour, hours) &&
-        matches(ltm.tm_mday, daysOfMonth) &&
-        matches(ltm.tm_mon + 1, months) &&
-        matches(ltm.tm_wday, daysOfWeek))
-    {
-
-        std::string currentExecutionID = createExecutionID(ltm);
-        if (lastExecutionID != currentExecutionID)
-        {
-            lastExecutionID = currentExecutionID;
-            return true;
-        }
-    }
-
-    return false;
-}
-
-std::string ScheduledTask::getSchedule() const
-{
-    return origSchedule;
-}
-
-std::string ScheduledTask::getConfig() const
-{
-    return extraConfig;
-}
-
-void ScheduledTask::parseSchedule(const std::string &schedule)
-{
-    std::istringstream ss(schedule);
-    std::string field;
-    for (int i = 0; i < 5 && std::getline(ss, field, ' '); ++i)
-    {
-        switch (i)
-        {
-        case 0:
-            minutes = parseField(field);
-            break;
-        case 1:
-            hours = parseField(field);
-            break;
-        case 2:
-            daysOfMonth = parseField(field);
-            break;
-        case 3:
-            months = parseField(field);
-            break;
-        case 4:
-            daysOfWeek = parseField(field);
-            break;
-        }
-    }
-    if (extraConfig.empty())
-        std::getline(ss, extraConfig);
-}
-
-std::vector<int> ScheduledTask::parseField(const std::string &field)
-{
-    std::vector<int> values;
-    if (field == "*")
-    {
-        // Handle the wildcard
-        // For simplicity, we're not handling steps like */5
-        return values; // An empty vector is a wildcard
-    }
-    std::istringstream ss(field);
-    std::string value;
-    while (std::getline(ss, value, ','))
-    {
-        values.push_back(std::stoi(value));
-    }
-    return values;
-}
-
-bool ScheduledTask::matches(int timeValue, const std::vector<int> &values)
-{
-    if (values.empty())
-        return true; // Wildcard
-    for (int value : values)
-    {
-        if (timeValue == value)
-            return true;
-    }
-    return false;
-}
-
-std::string ScheduledTask::createExecutionID(const std::tm &time)
-{
-    std::ostringstream oss;
-
-    // Minute
-    if (!minutes.empty() && minutes[0] != -1)
-    {
-        oss << "M" << time.tm_min;
-    }
-
-    // Hour
-    if (!hours.empty() && hours[0] != -1)
-    {
-        oss << "H" << time.tm_hour;
-    }
-
-    // Day of Month
-    if (!daysOfMonth.empty() && daysOfMonth[0] != -1)
-    {
-        oss << "D" << time.tm_mday;
-    }
-
-    // Month
-    if (!months.empty() && months[0] != -1)
-    {
-        oss << "Mo" << (time.tm_mon + 1); // tm_mon is 0-11
-    }
-
-    // Day of Week
-    if (!daysOfWeek.empty() && daysOfWeek[0] != -1)
-    {
-        oss << "W" << time.tm_wday; // tm_wday is 0-6, Sunday = 0
-    }
-
-    // If oss is empty, it means all fields are wildcards, so add minute
-    if (oss.str().empty())
-    {
-        oss << "M" << time.tm_min;
-    }
-
-    return oss.str();
-}
\ No newline at end of file
+/**
+ * @file ScheduledTask.cpp
+ * @author Slava Luchianov
+ * @brief
+ * @version 0.1
+ * @date 2023-12-08
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include "ScheduledTask.h"
+
+#include <algorithm>
+
+ScheduledTask::ScheduledTask(const std::string &schedule, const std::string &config,
+                             uint8_t priority, OverlapPolicy policy)
+    : extraConfig(config), priority(priority), overlapPolicy(policy)
+{
+    parseSchedule(schedule);
+    configHash = std::hash<std::string>()(extraConfig);
+}
+
+/**
+ * @brief Creates the task of a schedule compiled at the build time, no parsing involved.
+ * The rule points at the text of the literal, no copy on the heap.
+ */
+ScheduledTask::ScheduledTask(const CronLiteral &schedule, const std::string &config,
+                             uint8_t priority, OverlapPolicy policy)
+    : rules{{schedule.spec, std::string(), schedule.text, schedule.length}}, extraConfig(config),
+      configHash(std::hash<std::string>()(config)), priority(priority), overlapPolicy(policy)
+{
+}
+
+/**
+ * @brief Checks if the task fires at the given second, every second fires at most once.
+ * @param localWall The local wall clock second to evaluate, see ClockHelper::utc_to_local().
+ * @return True if the schedule matches and the task has not fired at this second yet.
+ */
+bool ScheduledTask::shouldRunAt(std::time_t localWall)
+{
+    std::tm ltm;
+    gmtime_r(&localWall, &ltm); // the wall clock is already local, no TZ rules involved
+
+    for (const Rule &rule : rules)
+    {
+        if (matches(ltm.tm_sec, rule.spec.seconds) && matchesMinute(rule.spec, ltm))
+        {
+            if (lastExecution == localWall)
+                return false;
+            lastExecution = localWall;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Finds the last second of the range the task matches, used for the local times
+ * skipped by the DST switch or a clock step. The task fires once for the whole range.
+ * @param localFrom The first local wall clock second of the range.
+ * @param localTo The last local wall clock second of the range, inclusive.
+ * @return The last matching second, or -1 if none matches or the task has fired within the range already.
+ */
+std::time_t ScheduledTask::lastRunWithin(std::time_t localFrom, std::time_t localTo)
+{
+    if (lastExecution >= localFrom)
+        return -1;
+
+    // from the last minute back, the first minute with a match holds the last one
+    for (std::time_t minute = localTo - localTo % 60; minute + 59 >= localFrom; minute -= 60)
+    {
+        std::tm ltm;
+        gmtime_r(&minute, &ltm);
+        // the seconds of this minute that belong to the range
+        int first = minute < localFrom ? (int)(localFrom - minute) : 0;
+        int last = minute + 59 > localTo ? (int)(localTo - minute) : 59;
+        uint64_t range = (~0ULL >> (63 - last)) & (~0ULL << first);
+        int lastSecond = -1;
+        for (const Rule &rule : rules)
+        {
+            uint64_t matching = rule.spec.seconds & range;
+            if (matching && matchesMinute(rule.spec, ltm))
+                lastSecond = std::max(lastSecond, 63 - __builtin_clzll(matching));
+        }
+        if (lastSecond >= 0)
+        {
+            lastExecution = localTo;
+            return minute + lastSecond;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds the next fire of the schedule, for the agenda. Does not touch the run state.
+ * @param localFrom The first local wall clock second to consider.
+ * @param localUntil The last local wall clock second to consider, inclusive.
+ * @return The local wall clock second of the fire, or -1 if there is none in the range.
+ */
+std::time_t ScheduledTask::nextRunAfter(std::time_t localFrom, std::time_t localUntil) const
+{
+    std::time_t next = -1;
+    for (const Rule &rule : rules)
+    {
+        // the later rules only need to beat the earliest fire so far
+        std::time_t match = (std::time_t)rule.spec.nextMatch(localFrom, next >= 0 ? next - 1 : localUntil);
+        if (match >= 0)
+            next = match;
+    }
+    return next;
+}
+
+/**
+ * @brief Takes over the rules of a task sending the same command, the tasks become one.
+ * A rule the task has already is not added again.
+ * Only for the tasks not published yet, the scheduler reads the rules without locking.
+ * @param other The task to merge, its run state is not taken over.
+ * @return True if merged, false if the config or the dispatch options differ.
+ */
+bool ScheduledTask::mergeRules(const ScheduledTask &other)
+{
+    if (configHash != other.configHash || extraConfig != other.extraConfig ||
+        priority != other.priority || overlapPolicy != other.overlapPolicy)
+        return false;
+    for (const Rule &rule : other.rules)
+    {
+        bool known = false;
+        for (const Rule &own : rules)
+            known = known || own.text() == rule.text();
+        if (!known)
+            rules.push_back(rule);
+    }
+    return true;
+}
+
+bool ScheduledTask::matchesMinute(const CronSpec &spec, const std::tm &time)
+{
+    return matches(time.tm_min, spec.minutes) &&
+           matches(time.tm_hour, spec.hours) &&
+           spec.matchesDay(time.tm_mday, time.tm_mon + 1, time.tm_wday);
+}
+
+// All the rules, separated by "; "
+std::string ScheduledTask::getSchedule() const
+{
+    std::string schedules;
+    for (const Rule &rule : rules)
+        schedules += (schedules.empty() ? "" : "; ") + rule.text();
+    return schedules;
+}
+
+std::string ScheduledTask::getConfig() const
+{
+    return extraConfig;
+}
+
+uint8_t ScheduledTask::getPriority() const
+{
+    return priority;
+}
+
+OverlapPolicy ScheduledTask::getOverlapPolicy() const
+{
+    return overlapPolicy;
+}
+
+void ScheduledTask::parseSchedule(const std::string &schedule)
+{
+    CronSpec spec = CronSpec::parse(schedule.c_str(), schedule.size());
+    if (!spec.valid)
+        stream_logger.printf("ScheduledTask: malformed schedule '%s'\n", schedule.c_str());
+    if (extraConfig.empty())
+        extraConfig = schedule.substr(spec.rest);
+    rules.push_back({spec, schedule});
+}
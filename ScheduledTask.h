@@ -1,38 +1,79 @@
-/**
- * @file ScheduledTask.h
- * @author Slava Luchianov
- * @brief
- * @version 0.1
- * @date 2023-12-08
- *
- * @copyright Copyright (c) 2023
- *
- */
-#pragma once
-#include <string>
-#include <vector>
-#include <sstream>
-#include <ctime>
-#include <memory>
-
-#include "StreamLogger.h"
-
-class ScheduledTask
-{
-public:
-    ScheduledTask(const std::string &schedule, const std::string &config = "");
-    bool shouldRunNow();
-    std::string getSchedule() const;
-    std::string getConfig() const;
-
-private:
-    std::vector<int> minutes, hours, daysOfMonth, months, daysOfWeek;
-    std::string extraConfig; // This holds the extra configuration, like the JSON command
-    std::string origSchedule;
-    std::string lastExecutionID;
-
-    void parseSchedule(const std::string &schedule);
-    std::vector<int> parseField(const std::string &field);
-    bool matches(int timeValue, const std::vector<int> &values);
-    std::string createExecutionID(const std::tm &time);
-};
+/**
+ * @file ScheduledTask.h
+ * @author Slava Luchianov
+ * @brief
+ * @version 0.1
+ * @date 2023-12-08
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+#include <string>
+#include <vector>
+#include <sstream>
+#include <ctime>
+#include <memory>
+#include <atomic>
+
+#include "StreamLogger.h"
+#include "CronSpec.h"
+
+/**
+ * @brief What the dispatcher does when a task fires while its previous run
+ * is still queued or executing.
+ */
+enum class OverlapPolicy : uint8_t
+{
+    SKIP = 0,      // drop the new fire, the previous one is still pending
+    QUEUE = 1,     // run again after the previous run, the fires meanwhile fold into one queued run
+    CONCURRENT = 2 // queue every fire as its own run, the runs still execute one at a time
+};
+
+class ScheduledTask
+{
+public:
+    ScheduledTask(const std::string &schedule, const std::string &config = "",
+                  uint8_t priority = 0, OverlapPolicy policy = OverlapPolicy::SKIP);
+    ScheduledTask(const CronLiteral &schedule, const std::string &config,
+                  uint8_t priority = 0, OverlapPolicy policy = OverlapPolicy::SKIP);
+    bool shouldRunAt(std::time_t localWall);
+    std::time_t lastRunWithin(std::time_t localFrom, std::time_t localTo);
+    std::time_t nextRunAfter(std::time_t localFrom, std::time_t localUntil) const;
+    bool mergeRules(const ScheduledTask &other);
+    std::string getSchedule() const;
+    size_t getRuleCount() const { return rules.size(); }
+    std::string getRuleSchedule(size_t rule) const { return rules[rule].text(); }
+    std::string getConfig() const;
+    size_t getConfigHash() const { return configHash; }
+    uint8_t getPriority() const;
+    OverlapPolicy getOverlapPolicy() const;
+
+    // Run state, owned by the CommandDispatcher
+    std::atomic<uint8_t> inFlight{0}; // queued + running instances
+    std::atomic<bool> running{false}; // an instance is executing right now
+    std::atomic<uint8_t> queued{0};   // instances waiting in the dispatcher queue
+
+private:
+    // A task fires when any of its rules matches, the crontab lines sending the same config
+    // are merged into one task, see mergeRules()
+    struct Rule
+    {
+        CronSpec spec;                 // the compiled schedule, one bit per allowed value
+        std::string schedule;          // the schedule as written, empty for a literal
+        const char *literal = nullptr; // the text of a _cron literal, in the flash .rodata
+        size_t literalLength = 0;
+
+        std::string text() const { return literal ? std::string(literal, literalLength) : schedule; }
+    };
+    std::vector<Rule> rules;
+    std::string extraConfig; // This holds the extra configuration, like the JSON command
+    size_t configHash = 0;   // to find the duplicate commands quickly
+    uint8_t priority;
+    OverlapPolicy overlapPolicy;
+    std::time_t lastExecution = 0; // the local wall clock second the task has fired last time
+
+    void parseSchedule(const std::string &schedule);
+    static bool matches(int timeValue, uint64_t mask) { return (mask >> timeValue) & 1; }
+    static bool matchesMinute(const CronSpec &spec, const std::tm &time);
+};
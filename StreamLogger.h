@@ -1,120 +1,164 @@
-#pragma once
-#include <Arduino.h>
-#include <BluetoothSerial.h>
-
-// Enumeration for log channels
-enum class LogChannel
-{
-    NONE = 0,
-    SERIAL_CHANNEL = 1,
-    BT_CHANNEL = 2
-};
-
-// StreamLogger class definition
-class StreamLogger
-{
-public:
-    HardwareSerial &serial_port;
-    BluetoothSerial &bt_serial;
-    LogChannel current_channel;
-
-    // TODO: introduce the level of verboseness, later
-
-    StreamLogger(HardwareSerial &serial, BluetoothSerial &bt)
-        : serial_port(serial), bt_serial(bt), current_channel(LogChannel::SERIAL_CHANNEL) {}
-
-    void configure_channel(LogChannel channel)
-    {
-        current_channel = channel;
-    }
-
-    Stream &get_channel()
-    {
-        if (current_channel == LogChannel::BT_CHANNEL)
-            return bt_serial;
-        else
-            return serial_port;
-    }
-
-    // Generic print method using templates
-    template <typename T>
-    void print(const T &message)
-    {
-        switch (current_channel)
-        {
-        case LogChannel::SERIAL_CHANNEL:
-            serial_port.print(message);
-            break;
-        case LogChannel::BT_CHANNEL:
-            bt_serial.print(message);
-            break;
-        case LogChannel::NONE:
-        default:
-            // No logging
-            break;
-        }
-    }
-
-    // Generic println method using templates
-    template <typename T>
-    void println(const T &message)
-    {
-        switch (current_channel)
-        {
-        case LogChannel::SERIAL_CHANNEL:
-            serial_port.println(message);
-            break;
-        case LogChannel::BT_CHANNEL:
-            bt_serial.println(message);
-            break;
-        case LogChannel::NONE:
-        default:
-            // No logging
-            break;
-        }
-    }
-
-    // Overload of println without any parameters
-    void println()
-    {
-        switch (current_channel)
-        {
-        case LogChannel::SERIAL_CHANNEL:
-            serial_port.println();
-            break;
-        case LogChannel::BT_CHANNEL:
-            bt_serial.println();
-            break;
-        case LogChannel::NONE:
-        default:
-            // No logging
-            break;
-        }
-    }
-    // Print formatted string
-    void printf(const char *format, ...)
-    {
-        char buffer[1024]; // Define the size as per your requirement
-        va_list args;
-        va_start(args, format);
-        vsnprintf(buffer, sizeof(buffer), format, args);
-        va_end(args);
-
-        switch (current_channel)
-        {
-        case LogChannel::SERIAL_CHANNEL:
-            serial_port.print(buffer);
-            break;
-        case LogChannel::BT_CHANNEL:
-            bt_serial.print(buffer);
-            break;
-        case LogChannel::NONE:
-        default:
-            // No logging
-            break;
-        }
-    }
-};
-
-// Global logger instance declaration
-extern StreamLogger stream_logger;
+#pragma once
+#include <Arduino.h>
+#include <algorithm>
+#include <BluetoothSerial.h>
+
+#include "CoalescingWriter.h"
+
+// Enumeration for log channels
+enum class LogChannel
+{
+    NONE = 0,
+    SERIAL_CHANNEL = 1,
+    BT_CHANNEL = 2
+};
+
+// StreamLogger class definition
+class StreamLogger
+{
+public:
+    HardwareSerial &serial_port;
+    BluetoothSerial &bt_serial;
+    LogChannel current_channel;
+
+    // All the output goes through these, the small writes are coalesced into the link sized chunks
+    CoalescingWriter serial_out;
+    CoalescingWriter bt_out;
+
+    // TODO: introduce the level of verboseness, later
+
+    StreamLogger(HardwareSerial &serial, BluetoothSerial &bt)
+        : serial_port(serial), bt_serial(bt), current_channel(LogChannel::SERIAL_CHANNEL),
+          serial_out(serial, 128), // the UART TX FIFO
+          bt_out(bt, 990)          // the SPP MTU of the ESP32 BT stack
+    {
+    }
+
+    void configure_channel(LogChannel channel)
+    {
+        current_channel = channel;
+    }
+
+    // The raw stream, for the readers and the direct writers, the pending output goes out first
+    Stream &get_channel()
+    {
+        flush();
+        if (current_channel == LogChannel::BT_CHANNEL)
+            return bt_serial;
+        else
+            return serial_port;
+    }
+
+    void flush()
+    {
+        serial_out.flush();
+        bt_out.flush();
+    }
+
+    // Call it every loop() pass, the pending output never waits longer than the writer deadline
+    void flush_if_due()
+    {
+        serial_out.flush_if_due();
+        bt_out.flush_if_due();
+    }
+
+    // The coalescing of each channel: the writes into the stream against the bytes, and why they were flushed
+    void print_output_stats()
+    {
+        print_writer_stats("serial", serial_out.get_stats());
+        print_writer_stats("BT", bt_out.get_stats());
+    }
+
+    // Generic print method using templates
+    template <typename T>
+    void print(const T &message)
+    {
+        switch (current_channel)
+        {
+        case LogChannel::SERIAL_CHANNEL:
+            serial_out.print(message);
+            break;
+        case LogChannel::BT_CHANNEL:
+            bt_out.print(message);
+            break;
+        case LogChannel::NONE:
+        default:
+            // No logging
+            break;
+        }
+    }
+
+    // Generic println method using templates
+    template <typename T>
+    void println(const T &message)
+    {
+        switch (current_channel)
+        {
+        case LogChannel::SERIAL_CHANNEL:
+            serial_out.println(message);
+            break;
+        case LogChannel::BT_CHANNEL:
+            bt_out.println(message);
+            break;
+        case LogChannel::NONE:
+        default:
+            // No logging
+            break;
+        }
+    }
+
+    // Overload of println without any parameters
+    void println()
+    {
+        switch (current_channel)
+        {
+        case LogChannel::SERIAL_CHANNEL:
+            serial_out.println();
+            break;
+        case LogChannel::BT_CHANNEL:
+            bt_out.println();
+            break;
+        case LogChannel::NONE:
+        default:
+            // No logging
+            break;
+        }
+    }
+    // Print formatted string
+    void printf(const char *format, ...)
+    {
+        char buffer[1024]; // Define the size as per your requirement
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length < 0)
+            return;
+        length = std::min<int>(length, sizeof(buffer) - 1);
+
+        switch (current_channel)
+        {
+        case LogChannel::SERIAL_CHANNEL:
+            serial_out.write((const uint8_t *)buffer, length);
+            break;
+        case LogChannel::BT_CHANNEL:
+            bt_out.write((const uint8_t *)buffer, length);
+            break;
+        case LogChannel::NONE:
+        default:
+            // No logging
+            break;
+        }
+    }
+
+private:
+    void print_writer_stats(const char *name, const CoalescingWriter::Stats &stats)
+    {
+        printf("Output %s: %u writes / %u bytes (flushes full %u, deadline %u, explicit %u)\n", name,
+               (unsigned)stats.writes, (unsigned)stats.bytes, (unsigned)stats.flushes_full,
+               (unsigned)stats.flushes_deadline, (unsigned)stats.flushes_explicit);
+    }
+};
+
+// Global logger instance declaration
+extern StreamLogger stream_logger;
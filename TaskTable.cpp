@@ -0,0 +1,59 @@
+/**
+ * @file TaskTable.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TaskTable.h"
+
+TaskTable::TaskTable()
+    : current(new TaskList())
+{
+    for (auto &epoch : readerEpochs)
+        epoch.store(0);
+}
+
+TaskTable::~TaskTable()
+{
+    for (const Retired &r : retired)
+        delete r.tasks;
+    delete current.load();
+}
+
+/**
+ * @brief Replaces the current snapshot, the caller holds the writer lock.
+ * @param next The new snapshot, the table takes the ownership.
+ */
+void TaskTable::publish(TaskList *next)
+{
+    const TaskList *previous = current.exchange(next);
+    // the readers announcing the epoch after this bump have loaded the new pointer
+    uint32_t epoch = globalEpoch.fetch_add(1);
+    retired.push_back({previous, epoch});
+    reclaim();
+}
+
+void TaskTable::reclaim()
+{
+    // the oldest epoch a busy reader has announced, the idle slots show 0
+    uint32_t oldestReader = UINT32_MAX;
+    for (auto &slot : readerEpochs)
+    {
+        uint32_t epoch = slot.load();
+        if (epoch != 0 && epoch < oldestReader)
+            oldestReader = epoch;
+    }
+
+    size_t kept = 0;
+    for (const Retired &r : retired)
+    {
+        if (r.epoch < oldestReader)
+            delete r.tasks;
+        else
+            retired[kept++] = r;
+    }
+    retired.resize(kept);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file TaskTable.h
+ * @brief The copy-on-write table of the scheduled tasks, the scheduler reads it without waiting.
+ *
+ * The table is an immutable snapshot behind an atomic pointer. The writers (serialized by
+ * the ScheduleManager writer lock) copy the current snapshot, change the copy and publish it.
+ * The replaced snapshot is retired and deleted once no reader can hold it (epoch based reclamation):
+ *
+ * - every reader owns a fixed slot, it announces the current global epoch there and then
+ *   loads the pointer, leaving resets the slot to 0 (idle); a few loads and stores, wait-free;
+ * - publishing swaps the pointer first and then bumps the epoch, the retired snapshot is
+ *   tagged with the epoch before the bump;
+ * - a reader that announced a later epoch has loaded the new pointer, so the snapshot
+ *   is deleted once every busy slot shows a later epoch than its tag.
+ *
+ * The tasks themselves are shared between the snapshots, their run state survives the mutations.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// The table only shares the tasks, it never looks inside them
+class ScheduledTask;
+
+using TaskList = std::vector<std::shared_ptr<ScheduledTask>>;
+
+class TaskTable
+{
+public:
+    // Every concurrent reader has its own slot
+    enum ReaderSlot : uint8_t
+    {
+        SCHEDULER_READER = 0, // the scheduler task
+        MANUAL_READER = 1,    // checkAndRunTasks() called by the firmware loop
+        AGENDA_READER = 2,    // agenda(), one at a time under the agenda lock
+        READER_SLOTS
+    };
+
+    // Holds the snapshot for the scope, the snapshot is not reclaimed until the guard goes away
+    class ReadGuard
+    {
+    public:
+        ReadGuard(TaskTable &table, ReaderSlot slot) : table(table), slot(slot)
+        {
+            table.readerEpochs[slot].store(table.globalEpoch.load());
+            tasks = table.current.load();
+        }
+        ~ReadGuard() { table.readerEpochs[slot].store(0); }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        const TaskList &operator*() const { return *tasks; }
+        const TaskList *operator->() const { return tasks; }
+
+    private:
+        TaskTable &table;
+        ReaderSlot slot;
+        const TaskList *tasks;
+    };
+
+    TaskTable();
+    ~TaskTable();
+
+    // For the writers only, under the writer lock, nobody reclaims the snapshot meanwhile
+    const TaskList &snapshot() const { return *current.load(); }
+    void publish(TaskList *next);
+    size_t retiredCount() const { return retired.size(); }
+
+private:
+    std::atomic<const TaskList *> current;
+    std::atomic<uint32_t> globalEpoch{1};
+    std::atomic<uint32_t> readerEpochs[READER_SLOTS];
+
+    struct Retired
+    {
+        const TaskList *tasks;
+        uint32_t epoch;
+    };
+    std::vector<Retired> retired; // touched by the writers only
+
+    void reclaim();
+};
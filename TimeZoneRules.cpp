@@ -0,0 +1,269 @@
+/**
+ * @file TimeZoneRules.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TimeZoneRules.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace
+{
+    bool is_leap_year(int year)
+    {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    int days_in_month(int year, int month)
+    {
+        static const uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return month == 2 && is_leap_year(year) ? 29 : days[month - 1];
+    }
+
+    // The POSIX TZ rule of a DST switch, "Mm.w.d", "Jn" or "n", followed by an optional "/time"
+    struct TzRule
+    {
+        char kind = 'M'; // 'M' month.week.weekday, 'J' julian 1-365 without Feb 29, 'D' zero based day
+        int month = 0, week = 0, weekday = 0, day = 0;
+        int32_t time = 2 * 3600; // local time of the switch, 02:00:00 by default
+    };
+
+    // The parser walks the TZ string with a cursor, every step returns false on malformed input
+    bool parse_tz_name(const char *&p)
+    {
+        const char *start = p;
+        if (*p == '<')
+        {
+            while (*p && *p != '>')
+                ++p;
+            if (*p != '>')
+                return false;
+            ++p;
+            return p - start > 2;
+        }
+        while (isalpha((unsigned char)*p))
+            ++p;
+        return p - start >= 3;
+    }
+
+    bool parse_tz_number(const char *&p, int &value)
+    {
+        if (!isdigit((unsigned char)*p))
+            return false;
+        value = 0;
+        while (isdigit((unsigned char)*p))
+            value = value * 10 + (*p++ - '0');
+        return true;
+    }
+
+    // [+|-]hh[:mm[:ss]]
+    bool parse_tz_time(const char *&p, int32_t &seconds)
+    {
+        int sign = 1;
+        if (*p == '+' || *p == '-')
+            sign = *p++ == '-' ? -1 : 1;
+        int hours = 0, minutes = 0, secs = 0;
+        if (!parse_tz_number(p, hours))
+            return false;
+        if (*p == ':' && !parse_tz_number(++p, minutes))
+            return false;
+        if (*p == ':' && !parse_tz_number(++p, secs))
+            return false;
+        seconds = sign * (hours * 3600 + minutes * 60 + secs);
+        return true;
+    }
+
+    bool parse_tz_rule(const char *&p, TzRule &rule)
+    {
+        if (*p == 'M')
+        {
+            rule.kind = 'M';
+            if (!parse_tz_number(++p, rule.month) || *p != '.' ||
+                !parse_tz_number(++p, rule.week) || *p != '.' ||
+                !parse_tz_number(++p, rule.weekday))
+                return false;
+            if (rule.month < 1 || rule.month > 12 || rule.week < 1 || rule.week > 5 || rule.weekday > 6)
+                return false;
+        }
+        else if (*p == 'J')
+        {
+            rule.kind = 'J';
+            if (!parse_tz_number(++p, rule.day) || rule.day < 1 || rule.day > 365)
+                return false;
+        }
+        else
+        {
+            rule.kind = 'D';
+            if (!parse_tz_number(p, rule.day) || rule.day > 365)
+                return false;
+        }
+        if (*p == '/')
+            return parse_tz_time(++p, rule.time);
+        return true;
+    }
+
+    // Days since 1970-01-01 of the rule date in the given year
+    int64_t rule_day(const TzRule &rule, int year)
+    {
+        const int64_t jan1 = TimeZoneRules::days_from_civil(year, 1, 1);
+        if (rule.kind == 'J') // Feb 29 is never counted
+            return jan1 + rule.day - 1 + (is_leap_year(year) && rule.day >= 60 ? 1 : 0);
+        if (rule.kind == 'D')
+            return jan1 + rule.day;
+
+        const int64_t first = TimeZoneRules::days_from_civil(year, rule.month, 1);
+        const int first_weekday = (int)((first + 4) % 7); // 1970-01-01 was a Thursday
+        int day = 1 + (rule.weekday - first_weekday + 7) % 7 + (rule.week - 1) * 7;
+        while (day > days_in_month(year, rule.month)) // week 5 means "the last one"
+            day -= 7;
+        return first + day - 1;
+    }
+}
+
+int64_t TimeZoneRules::days_from_civil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t year_of_era = year - era * 400;
+    const int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+/**
+ * @brief Parses the POSIX TZ string and precomputes the transitions of table_years years.
+ * @param posix_tz E.g. "CET-1CEST,M3.5.0,M10.5.0/3" or "UTC0". A zone with the DST name
+ * but without the rules switches by the US rules, "M3.2.0,M11.1.0".
+ * @param first_year The first year of the table.
+ * @return False if the string is malformed, the current table stays intact then.
+ */
+bool TimeZoneRules::build(const std::string &posix_tz, int first_year)
+{
+    const char *p = posix_tz.c_str();
+    int32_t std_offset = 0, dst_offset = 0;
+    TzRule start, end;
+
+    if (!parse_tz_name(p) || !parse_tz_time(p, std_offset))
+        return false;
+    std_offset = -std_offset; // POSIX counts west of Greenwich as positive
+
+    bool has_dst = *p != '\0';
+    if (has_dst)
+    {
+        if (!parse_tz_name(p))
+            return false;
+        dst_offset = std_offset + 3600;
+        if (*p != ',' && *p != '\0')
+        {
+            if (!parse_tz_time(p, dst_offset))
+                return false;
+            dst_offset = -dst_offset;
+        }
+        if (*p == ',')
+        {
+            if (!parse_tz_rule(++p, start) || *p != ',' || !parse_tz_rule(++p, end))
+                return false;
+        }
+        else
+        {
+            start.month = 3, start.week = 2, start.weekday = 0;
+            end.month = 11, end.week = 1, end.weekday = 0;
+        }
+        if (*p != '\0')
+            return false;
+    }
+
+    std::vector<TzTransition> table;
+    if (has_dst)
+    {
+        table.reserve(2 * table_years);
+        for (int year = first_year; year < first_year + table_years; ++year)
+        {
+            // the switch times are in the local time in force before the switch
+            table.push_back({(std::time_t)(rule_day(start, year) * seconds_per_day + start.time - std_offset),
+                             dst_offset});
+            table.push_back({(std::time_t)(rule_day(end, year) * seconds_per_day + end.time - dst_offset),
+                             std_offset});
+        }
+        std::sort(table.begin(), table.end(),
+                  [](const TzTransition &a, const TzTransition &b)
+                  { return a.utc < b.utc; });
+    }
+
+    transitions.swap(table);
+    // the year starts in the standard time, unless it's the southern hemisphere
+    base_offset = transitions.empty() || transitions.front().offset == dst_offset ? std_offset : dst_offset;
+    this->first_year = first_year;
+    this->posix_tz = posix_tz;
+    return true;
+}
+
+/**
+ * @brief Converts UTC to the local wall clock, a binary search in the transition table.
+ * @param utc Seconds since the epoch.
+ * @return The local wall clock expressed as seconds since the epoch, break it down with gmtime_r().
+ */
+std::time_t TimeZoneRules::utc_to_local(std::time_t utc) const
+{
+    auto next = std::upper_bound(transitions.begin(), transitions.end(), utc,
+                                 [](std::time_t t, const TzTransition &tr)
+                                 { return t < tr.utc; });
+    int32_t offset = next == transitions.begin() ? base_offset : (next - 1)->offset;
+    return utc + offset;
+}
+
+/**
+ * @brief Converts the local wall clock to UTC.
+ * @param local The local wall clock expressed as seconds since the epoch.
+ * @return The UTC seconds. A repeated local time resolves to its first occurrence,
+ * a nonexistent one (skipped by the DST switch) resolves to the first second after the gap.
+ */
+std::time_t TimeZoneRules::local_to_utc(std::time_t local) const
+{
+    int32_t offset = base_offset;
+    std::time_t utc = local - offset;
+    for (const TzTransition &tr : transitions)
+    {
+        // before this transition, the previous offset maps the local time fine
+        if (local - offset < tr.utc)
+            break;
+        // after it the new offset applies, for the gaps local - tr.offset lands before tr.utc
+        utc = std::max<std::time_t>(local - tr.offset, tr.utc);
+        offset = tr.offset;
+    }
+    return utc;
+}
+
+/**
+ * @brief Converts the local wall clock to UTC, a repeated local time to its occurrence closest to near_utc.
+ * @param local The local wall clock expressed as seconds since the epoch.
+ * @param near_utc The UTC the time is expected around, e.g. the current clock.
+ * @return The UTC seconds, a nonexistent local time resolves like local_to_utc(local).
+ */
+std::time_t TimeZoneRules::local_to_utc(std::time_t local, std::time_t near_utc) const
+{
+    std::time_t best = local_to_utc(local);
+    // every span of a constant offset that maps to the local time is an occurrence
+    for (size_t i = 0; i < transitions.size(); ++i)
+    {
+        std::time_t utc = local - transitions[i].offset;
+        bool inside = utc >= transitions[i].utc && (i + 1 == transitions.size() || utc < transitions[i + 1].utc);
+        if (inside && std::llabs(utc - near_utc) < std::llabs(best - near_utc))
+            best = utc;
+    }
+    return best;
+}
+
+void TimeZoneRules::swap(TimeZoneRules &other)
+{
+    posix_tz.swap(other.posix_tz);
+    std::swap(base_offset, other.base_offset);
+    transitions.swap(other.transitions);
+    std::swap(first_year, other.first_year);
+}
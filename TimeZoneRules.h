@@ -0,0 +1,54 @@
+/**
+ * @file TimeZoneRules.h
+ * @brief The local wall clock of a POSIX TZ string, free of the Arduino and the RTC.
+ *
+ * The rules of the TZ string (e.g. "EST5EDT,M3.2.0,M11.1.0") are evaluated once, into a table
+ * of the offset transitions covering table_years years, so the conversions are a binary search
+ * plus an add. ClockHelper keeps one instance under its lock, the host tests use it directly.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// A change of the UTC offset, effective from the utc second on
+struct TzTransition
+{
+    std::time_t utc;
+    int32_t offset; // seconds to add to UTC to get the local wall clock
+};
+
+class TimeZoneRules
+{
+public:
+    // How many years the transition table covers starting with first_year
+    static const int table_years = 8;
+    static const int32_t seconds_per_day = 86400;
+
+    // Days since 1970-01-01 of the proleptic Gregorian date, month 1-12
+    static int64_t days_from_civil(int year, int month, int day);
+
+    bool build(const std::string &posix_tz, int first_year);
+    std::time_t utc_to_local(std::time_t utc) const;
+    std::time_t local_to_utc(std::time_t local) const;
+    std::time_t local_to_utc(std::time_t local, std::time_t near_utc) const;
+    bool covers(int year) const { return year > first_year && year < first_year + table_years - 1; }
+    void swap(TimeZoneRules &other);
+
+    const std::string &get_posix_tz() const { return posix_tz; }
+    int get_first_year() const { return first_year; }
+    const std::vector<TzTransition> &get_transitions() const { return transitions; }
+
+private:
+    std::string posix_tz = "UTC0";
+    int32_t base_offset = 0;               // the offset before the first transition
+    std::vector<TzTransition> transitions; // sorted by utc
+    int first_year = 0;
+};
@@ -0,0 +1,57 @@
+/**
+ * @file WallClockSequence.h
+ * @brief Maps the evaluated UTC seconds onto the local wall clock seconds to serve, once each.
+ *
+ * The scheduler evaluates one UTC second at a time, the cron rules match the local wall clock.
+ * The wall clock jumps, the sequence turns the jumps into the ranges to evaluate:
+ * - forward (spring forward, the clock stepped ahead by a sync), the skipped local times are
+ *   served once at the first second after the jump, up to maxCatchUpSeconds back;
+ * - backward (fall back, the clock stepped back), the repeated local times are not served again,
+ *   every wall clock time fires once. A step back further than maxCatchUpSeconds restarts the sequence.
+ *
+ * No Arduino dependency, the host tests drive it with TimeZoneRules.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <ctime>
+
+class WallClockSequence
+{
+public:
+    explicit WallClockSequence(std::time_t maxCatchUpSeconds = 3600) : maxCatchUpSeconds(maxCatchUpSeconds) {}
+
+    /**
+     * @brief Advances the sequence to the next evaluated second.
+     * @param utc The evaluated UTC second.
+     * @param local The local wall clock of it.
+     * @param gapFrom Receives the first skipped local second, the range up to local - 1
+     *                is to be served along with local, 0 if nothing was skipped.
+     * @return False if the local second has been served already.
+     */
+    bool advance(std::time_t utc, std::time_t local, std::time_t &gapFrom)
+    {
+        gapFrom = 0;
+        if (lastUtc != 0)
+        {
+            if (local <= lastLocal && lastLocal - local <= maxCatchUpSeconds)
+                return false;
+            if (local > lastLocal + 1)
+                gapFrom = std::max(lastLocal + 1, local - maxCatchUpSeconds);
+        }
+        lastUtc = utc;
+        lastLocal = local;
+        return true;
+    }
+
+private:
+    std::time_t maxCatchUpSeconds;
+    // the last served second, UTC and the local wall clock
+    std::time_t lastUtc = 0;
+    std::time_t lastLocal = 0;
+};
@@ -1,179 +1,196 @@
-/**
- * @file main.cpp
- * @author Slava Luchianov
- * @date 2023-11-01
- * @brief The main.cpp for ESP32 contains the two most important methods setup() and loop()
- *
- * The setup() is executed once in the beginning of the execution,
- *    with the power_on event or after the reset event, after the crash or by the reset button.
- *
- * @section Section 1, Singletons
- * The application consists of a hierarchy of several singletons
- * PWM Adapter object takes care about controlling the servos
- * BT Serial object supports a duplex communication with the mobile device
- * Schedule Manager fixes the schedule turning the path player on/off to control the laser
- * Storage Manager supports (de)serialization of the Path Manager content in the flash storage
- *
- * @section Section 2, setup()
- * This method initializes the required components.
- * For example it starts the scheduler component
- *
- * @section Section 3, loop()
- * This method communicates with the clients over the Bluetooth or Serial channels.
- * It reads as much as it can and then passes the collected content into the command processor
- *
- */
-
-#include <Arduino.h>
-#include <ESP.h>
-#include <BluetoothSerial.h>
-#include "SPIFFS.h"
-
-#include <cstdio>
-#include <ctime>
-#include <iostream>
-#include <string>
-#include <vector>
-#include <sstream>
-#include <functional>
-
-#include "StreamLogger.h"
-#include "AlgoHelper.h"
-#include "ClockHelper.h"
-#include "ServoAdapter.h"
-#include "ServoController.h"
-#include "CommandProcessor.h"
-#include "ScheduleManager.h"
-#include "LaserHelper.h"
-
-// TODO: change cross the project from the String to the std::string
-String input_string;         // A string to hold incoming data
-bool stringComplete = false; // Whether the string is complete
-long iterations = 0;
-
-// Create all your shared singletons here to pass them into the CommandProcessor constructor later
-HardwareSerial &default_serial = Serial; // Reference to the default hardware serial
-BluetoothSerial bt_serial;
-
-// Global logger instance definition
-StreamLogger stream_logger(default_serial, bt_serial);
-
-// Hardware controlling hierarchy instantiation
-LaserHelper laser_helper;
-ServoAdapter servo_x;
-ServoAdapter servo_y;
-ServoController servo_controller;
-ScheduleManager schedule_manager;
-CommandProcessor command_processor;
-ClockHelper runtime_clock_helper;
-
-void setup()
-{
-    // TODO: rename the registered name to something like "SmartLaserController" or LaserCatnip :)
-    bt_serial.begin("ESP32");
-    default_serial.begin(115200); // Initialize serial communication at 115200 baud
-    stream_logger.println("main.cpp.setup(): listen to BT and Serial, log the response");
-
-    laser_helper.delayed_setup();
-    runtime_clock_helper.delayed_setup();
-
-    //  Initialize SPIFFS
-    if (!SPIFFS.begin(true))
-        stream_logger.println("An Error has occurred while mounting SPIFFS");
-
-    // Let's restore the working schedule from the flash memory, to know when to turn it on/off
-    schedule_manager.delayed_setup();
-
-    // Let's restore all the paths and the scale info from the flash memory
-    path_manager.delayed_setup();
-
-#ifndef PROD
-    // Starting the player
-    std::string startPlayerCommand = "{\"command\":\"path_player_switch\",\"player\":\"on\"}";
-    command_processor.process_command(startPlayerCommand);
-
-    stream_logger.printf("setup() running on core # %d\n", xPortGetCoreID());
-    stream_logger.printf("Flash memory size: %d bytes\n", ESP.getFlashChipSize());
-#endif
-
-    input_string.reserve(1000); // Reserve 1000 bytes for the inputString
-}
-
-/**
- * @brief Define an std::function lambda that binds to process_command method
- * of the command_processor to make the schedule_manager.checkAndRunTasks(...lambda...) method
- * happy (many thanks to Chat GPT)
- */
-auto processCommandFunc = [](std::string &config) -> bool
-{
-    return command_processor.process_command(config);
-};
-
-void loop()
-{
-    runtime_clock_helper.synchronize_esp32_to_rtc_at_24_hours();
-
-    if (iterations % 1000 == 0) // every 1 seconds
-        schedule_manager.checkAndRunTasks(processCommandFunc);
-
-    // Print a heartbeat dot "\n" every 1min, which takes care about the recurrent garbage in the Serial channel, which we noticed when no 'line break' was in the channel
-    if (iterations % 60000 == 0)
-        stream_logger.printf("\n");
-    // Print a heartbeat dot "." every 50 seconds
-    if (iterations++ % 5000 == 0)
-        stream_logger.print(".");
-    if (iterations >= LONG_MAX - 10)
-        iterations = 0;
-
-    // Check for serial input as an alternative method to feed the commands into ESP32
-    while (Serial.available())
-    {
-        char inChar = (char)Serial.read(); // Read a character from the serial port
-        Serial.write(inChar);              // an echo to see what we actually type into Serial
-        input_string += inChar;            // Append it to the input string
-        if (inChar == '\n')
-        { // If it is a newline, set a flag so the main loop can process it
-            stringComplete = true;
-            break;
-        }
-    }
-
-    // Check for incoming BT data
-    while (bt_serial.available())
-    {
-        char inChar = bt_serial.read();
-        Serial.print(inChar);   // Echo like output from BT to Serial
-        input_string += inChar; // Append it to the input string
-        if (inChar == '\n')
-        { // If the incoming character is a newline, set a flag so the main loop can process it
-            stringComplete = true;
-            break;
-        }
-    }
-    vTaskDelay(1); // param is the delay in ticks until the next control cycle
-    // If a complete string from the serial port has been received
-    if (stringComplete)
-    {
-        runtime_clock_helper.time_stamp_to_serial();
-        //  Example of sending a response back
-        String response = "main.cpp.loop():\t Received a message: ";
-        response.concat(input_string);
-        stream_logger.print(response);
-        bt_serial.print(response);
-        std::vector<std::string> lines = AlgoHelper::split_string(input_string.c_str(), '\n');
-        for (std::string line : lines)
-        {
-            if (line.length() > 1)
-            {
-                bool retCode = command_processor.process_command(line);
-                stream_logger.printf("main.cpp.loop():\t The command processing returns %d \n\n",
-                                     retCode);
-                bt_serial.printf("main.cpp.loop():\t The command processing returns %d \n\n",
-                                 retCode);
-            }
-        }
-
-        input_string.clear();
-        stringComplete = false; // Reset the flag
-    }
-}
+/**
+ * @file main.cpp
+ * @author Slava Luchianov
+ * @date 2023-11-01
+ * @brief The main.cpp for ESP32 contains the two most important methods setup() and loop()
+ *
+ * The setup() is executed once in the beginning of the execution,
+ *    with the power_on event or after the reset event, after the crash or by the reset button.
+ *
+ * @section Section 1, Singletons
+ * The application consists of a hierarchy of several singletons
+ * PWM Adapter object takes care about controlling the servos
+ * BT Serial object supports a duplex communication with the mobile device
+ * Schedule Manager fixes the schedule turning the path player on/off to control the laser
+ * Storage Manager supports (de)serialization of the Path Manager content in the flash storage
+ *
+ * @section Section 2, setup()
+ * This method initializes the required components.
+ * For example it starts the scheduler component
+ *
+ * @section Section 3, loop()
+ * This method communicates with the clients over the Bluetooth or Serial channels.
+ * Every channel reads what its input budget allows (see InputChannel.h) and passes
+ * the admitted commands into the command processor, a flooding client gets the busy replies
+ *
+ */
+
+#include <Arduino.h>
+#include <ESP.h>
+#include <BluetoothSerial.h>
+#include "SPIFFS.h"
+
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <functional>
+
+#include "StreamLogger.h"
+#include "AlgoHelper.h"
+#include "ClockHelper.h"
+#include "ServoAdapter.h"
+#include "ServoController.h"
+#include "CommandProcessor.h"
+#include "ScheduleManager.h"
+#include "LaserHelper.h"
+#include "BulkReceiver.h"
+#include "InputChannel.h"
+#include "LoopMetrics.h"
+
+long iterations = 0;
+
+// Create all your shared singletons here to pass them into the CommandProcessor constructor later
+HardwareSerial &default_serial = Serial; // Reference to the default hardware serial
+BluetoothSerial bt_serial;
+
+// Global logger instance definition
+StreamLogger stream_logger(default_serial, bt_serial);
+
+// The command input of the channels, the echo goes to Serial, the busy replies to the sender.
+// The UART has no flow control, a byte budget would overflow its RX buffer, see InputChannel.h
+InputChannel serial_input(Serial, stream_logger.serial_out, stream_logger.serial_out, "Serial",
+                          InputChannel::Limits::without_byte_budget());
+InputChannel bt_input(bt_serial, stream_logger.serial_out, stream_logger.bt_out, "BT");
+std::vector<std::string> input_commands; // the commands admitted in the current loop() pass
+
+// Hardware controlling hierarchy instantiation
+LaserHelper laser_helper;
+ServoAdapter servo_x;
+ServoAdapter servo_y;
+ServoController servo_controller;
+ScheduleManager schedule_manager;
+CommandProcessor command_processor;
+ClockHelper runtime_clock_helper;
+BulkReceiver bulk_receiver;
+// The METRICS line every minute, for the soak runs, see LoopMetrics.h
+LoopMetrics loop_metrics(schedule_manager, stream_logger, serial_input, bt_input);
+
+// The CommandProcessor, the path player and the servos are single-threaded,
+// the loop() and the dispatcher worker take turns executing the commands under this lock
+SemaphoreHandle_t command_mutex = xSemaphoreCreateMutex();
+
+/**
+ * @brief Define an std::function lambda that binds to process_command method
+ * of the command_processor to make the schedule_manager.startScheduler(...lambda...) method
+ * happy (many thanks to Chat GPT)
+ * Every command goes through it, so the commands never run in parallel.
+ */
+auto processCommandFunc = [](std::string &config) -> bool
+{
+    xSemaphoreTake(command_mutex, portMAX_DELAY);
+    bool retCode = command_processor.process_command(config);
+    xSemaphoreGive(command_mutex);
+    return retCode;
+};
+
+void setup()
+{
+    // TODO: rename the registered name to something like "SmartLaserController" or LaserCatnip :)
+    bt_serial.begin("ESP32");
+    default_serial.begin(115200); // Initialize serial communication at 115200 baud
+    stream_logger.println("main.cpp.setup(): listen to BT and Serial, log the response");
+
+    laser_helper.delayed_setup();
+    runtime_clock_helper.delayed_setup();
+
+    //  Initialize SPIFFS
+    if (!SPIFFS.begin(true))
+        stream_logger.println("An Error has occurred while mounting SPIFFS");
+
+    // The schedules follow the local wall clock, restore the time zone before the scheduler starts
+    runtime_clock_helper.restore_time_zone();
+
+    // Let's restore the working schedule from the flash memory, to know when to turn it on/off
+    schedule_manager.delayed_setup();
+    // The scheduler wakes up on the second boundaries in its own task, not in loop()
+    schedule_manager.startScheduler(processCommandFunc);
+
+    // Let's restore all the paths and the scale info from the flash memory
+    path_manager.delayed_setup();
+
+#ifndef PROD
+    // Starting the player
+    std::string startPlayerCommand = "{\"command\":\"path_player_switch\",\"player\":\"on\"}";
+    processCommandFunc(startPlayerCommand);
+
+    stream_logger.printf("setup() running on core # %d\n", xPortGetCoreID());
+    stream_logger.printf("Flash memory size: %d bytes\n", ESP.getFlashChipSize());
+#endif
+
+    input_commands.reserve(4);
+    loop_metrics.begin();
+}
+
+void loop()
+{
+    loop_metrics.pass_started();
+    runtime_clock_helper.synchronize_esp32_to_rtc_at_24_hours();
+
+    // Print a heartbeat dot "\n" every 1min, which takes care about the recurrent garbage in the Serial channel, which we noticed when no 'line break' was in the channel
+    if (iterations % 60000 == 0)
+        stream_logger.printf("\n");
+    // Print a heartbeat dot "." every 50 seconds
+    if (iterations++ % 5000 == 0)
+        stream_logger.print(".");
+    if (iterations >= LONG_MAX - 10)
+        iterations = 0;
+
+    // The framed bulk transfer bypasses the line protocol and the echo, see BulkReceiver.h
+    bool serialBulk = bulk_receiver.claims(Serial, serial_input.at_line_start());
+    if (serialBulk)
+        bulk_receiver.poll(Serial);
+    bool btBulk = !serialBulk && bulk_receiver.claims(bt_serial, bt_input.at_line_start());
+    if (btBulk)
+        bulk_receiver.poll(bt_serial);
+
+    // Serial is an alternative method to feed the commands into ESP32, both are rate limited
+    if (!serialBulk)
+        serial_input.poll(input_commands);
+    if (!btBulk)
+        bt_input.poll(input_commands);
+
+    vTaskDelay(1); // param is the delay in ticks until the next control cycle
+    // If complete commands have been received
+    if (!input_commands.empty())
+    {
+        uint32_t handling_start_us = micros();
+        runtime_clock_helper.time_stamp_to_serial();
+        for (std::string &line : input_commands)
+        {
+            //  Example of sending a response back
+            String response = "main.cpp.loop():\t Received a message: ";
+            response.concat(line.c_str());
+            response.concat('\n');
+            stream_logger.print(response);
+            stream_logger.bt_out.print(response);
+
+            bool retCode = processCommandFunc(line);
+            stream_logger.printf("main.cpp.loop():\t The command processing returns %d \n\n",
+                                 retCode);
+            stream_logger.bt_out.printf("main.cpp.loop():\t The command processing returns %d \n\n",
+                                        retCode);
+            loop_metrics.command_done(micros() - handling_start_us);
+        }
+
+        input_commands.clear();
+        stream_logger.flush(); // the client waits for the response, don't hold it till the deadline
+    }
+
+    loop_metrics.report_if_due();
+    // The coalesced output (echoes, heartbeat, logs of the workers) never waits longer than the deadline
+    stream_logger.flush_if_due();
+    loop_metrics.pass_finished();
+}
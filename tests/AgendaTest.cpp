@@ -0,0 +1,183 @@
+/**
+ * @file AgendaTest.cpp
+ * @brief CronSpec::nextMatch() and the agenda against a second by second scan, and the agenda time
+ * of a large crontab.
+ *
+ * The scan is the reference: every second of the range is broken down by gmtime_r() and tested
+ * against the masks, the day fields the cron way (either one when both are restricted). The ranges
+ * cross the month ends, a leap February and the year end.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <BluetoothSerial.h>
+#include "ClockHelper.h"
+#include "ScheduleManager.h"
+
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+BluetoothSerial bt_serial;
+StreamLogger stream_logger(Serial, bt_serial);
+ClockHelper runtime_clock_helper;
+ScheduleManager schedule_manager;
+
+namespace
+{
+    std::time_t at(int year, int month, int day, int hour = 0, int minute = 0, int second = 0)
+    {
+        return TimeZoneRules::days_from_civil(year, month, day) * TimeZoneRules::seconds_per_day +
+               hour * 3600 + minute * 60 + second;
+    }
+
+    struct Range
+    {
+        std::time_t from, until;
+    };
+    const Range kRanges[] = {
+        {at(2024, 1, 29, 12), at(2024, 2, 2)},    // January 31
+        {at(2024, 2, 26), at(2024, 3, 2)},        // the leap February 29
+        {at(2023, 2, 25), at(2023, 3, 2)},        // the February of a common year
+        {at(2025, 4, 28, 6), at(2025, 5, 2)},     // a 30 day month
+        {at(2024, 12, 29), at(2025, 1, 2, 23)},   // the year end
+        {at(2025, 1, 12), at(2025, 1, 14, 12)}};  // Monday the 13th
+
+    const char *kSchedules[] = {
+        "0 0 1,15 * 1",        // the 1st, the 15th and every Monday
+        "0 0 13 * 5",          // the 13th and every Friday
+        "30 59 23 31 * *",     // the month ends, the last second but 29
+        "0 12 29,30,31 2 *",   // only February 29
+        "0 0 28,29 2 0,6",     // February 28/29 or a weekend day in February
+        "15,45 30 23 * * 0,6", // the weekends, with the seconds
+        "0 0,30 9,17 * * 1,2,3,4,5",
+        "7 * * 1 * *",         // every minute of the 1st
+        "0 6 31 4 *"};         // April 31 never comes
+
+    // The reference, straight from the broken down time
+    bool matches(const CronSpec &spec, std::time_t t)
+    {
+        std::tm tm;
+        gmtime_r(&t, &tm);
+        bool dayOfMonth = (spec.daysOfMonth >> tm.tm_mday) & 1;
+        bool weekday = (spec.daysOfWeek >> tm.tm_wday) & 1;
+        bool restrictedBoth = spec.daysOfMonth != 0xFFFFFFFEu && spec.daysOfWeek != 0x7F;
+        bool day = restrictedBoth ? dayOfMonth || weekday : dayOfMonth && weekday;
+        return day && ((spec.months >> (tm.tm_mon + 1)) & 1) && ((spec.hours >> tm.tm_hour) & 1) &&
+               ((spec.minutes >> tm.tm_min) & 1) && ((spec.seconds >> tm.tm_sec) & 1);
+    }
+
+    // The chain of the next matches equals the scan, and the task fires at the same seconds
+    void test_next_match()
+    {
+        for (const char *text : kSchedules)
+        {
+            CronSpec spec = CronSpec::parse(text, std::strlen(text));
+            CHECK(spec.valid);
+            ScheduledTask task(text);
+            for (const Range &range : kRanges)
+            {
+                std::vector<std::time_t> scanned, chained;
+                for (std::time_t t = range.from; t <= range.until; ++t)
+                {
+                    bool match = matches(spec, t);
+                    if (match)
+                        scanned.push_back(t);
+                    if (task.shouldRunAt(t) != match)
+                    {
+                        std::printf("%s: shouldRunAt(%lld) differs\n", text, (long long)t);
+                        CHECK(false);
+                    }
+                }
+                for (int64_t t = spec.nextMatch(range.from, range.until); t >= 0; t = spec.nextMatch(t + 1, range.until))
+                    chained.push_back((std::time_t)t);
+                if (scanned != chained)
+                    std::printf("%s from %lld: %zu scanned, %zu chained\n", text, (long long)range.from,
+                                scanned.size(), chained.size());
+                CHECK(scanned == chained);
+            }
+        }
+        // the range of an impossible date ends the search instead of looping over the years
+        CronSpec never = CronSpec::parse("0 0 30 2 *", 10);
+        CHECK_EQ(never.nextMatch(at(2024, 1, 1), at(2032, 1, 1)), -1);
+    }
+
+    // Every task of the table in the agenda, the same second in the task order
+    void test_agenda_order()
+    {
+        ScheduleManager manager;
+        for (const char *text : kSchedules)
+            manager.addTask(text, std::string("{\"command\":\"path_player_switch\",\"rule\":\"") + text + "\"}");
+        const Range &range = kRanges[0];
+
+        std::vector<std::pair<std::time_t, int>> scanned, listed;
+        std::vector<CronSpec> specs;
+        for (const char *text : kSchedules)
+            specs.push_back(CronSpec::parse(text, std::strlen(text)));
+        for (std::time_t t = range.from; t <= range.until; ++t)
+            for (int i = 0; i < (int)specs.size(); ++i)
+                if (matches(specs[i], t))
+                    scanned.emplace_back(t, i);
+        size_t count = manager.agenda(range.from, range.until, "",
+                                      [&](std::time_t localWall, int taskIndex, const ScheduledTask &)
+                                      {
+                                          listed.emplace_back(localWall, taskIndex);
+                                          return true;
+                                      });
+        CHECK_EQ(count, scanned.size());
+        CHECK(listed == scanned);
+
+        // the filter keeps the task of the month ends only, January 31 is the one in the range
+        listed.clear();
+        count = manager.agenda(range.from, range.until, "\"30 59 23 31 * *\"",
+                               [&](std::time_t localWall, int taskIndex, const ScheduledTask &)
+                               {
+                                   listed.emplace_back(localWall, taskIndex);
+                                   return true;
+                               });
+        CHECK_EQ(count, 1);
+        CHECK(listed == (std::vector<std::pair<std::time_t, int>>{{at(2024, 1, 31, 23, 59, 30), 2}}));
+    }
+
+    // 7 days of 10k tasks, a few fires a day each, within a bound the per second scan can't get near
+    void test_agenda_time()
+    {
+        const int tasks = 10000;
+        File file = SPIFFS.open("/crontab", FILE_WRITE);
+        for (int i = 0; i < tasks; ++i)
+        {
+            char line[96];
+            snprintf(line, sizeof(line), "%d %d %d,%d * * * |{\"command\":\"path_player_switch\",\"task\":%d}",
+                     i % 60, (i / 60) % 60, i % 24, (i + 12) % 24, i);
+            file.println(line);
+        }
+        file.close();
+        Serial.on_write = [](const uint8_t *, size_t) {}; // the crontab lines of the restore
+        schedule_manager.restoreFromSpiffs();
+        Serial.on_write = nullptr;
+
+        const std::time_t from = at(2025, 10, 20);
+        auto start = std::chrono::steady_clock::now();
+        size_t count = schedule_manager.agenda(from, from + 7 * 86400 - 1, "",
+                                               [](std::time_t, int, const ScheduledTask &)
+                                               { return true; });
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::printf("agenda: %zu fires of %d tasks over 7 days in %.1f ms\n", count, tasks, ms);
+        CHECK_EQ(count, (size_t)tasks * 2 * 7);
+        CHECK(ms < 1000); // some 25 ms optimized, the tests build without optimization
+    }
+}
+
+int main()
+{
+    test_next_match();
+    test_agenda_order();
+    test_agenda_time();
+    host::finish(test_result("AgendaTest"));
+}
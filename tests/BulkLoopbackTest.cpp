@@ -0,0 +1,394 @@
+/**
+ * @file BulkLoopbackTest.cpp
+ * @brief The bulk upload over a lossy loopback link, the framed protocol against the line protocol.
+ *
+ * The controller side is the firmware BulkReceiver on the BT port, writing into the in-memory SPIFFS.
+ * The client side runs as another task on the same virtual clock:
+ * - framed: the go-back-N sender of Program.cs (SendBulk), the same window, timeouts and retries;
+ * - line: the "download_file_image" command line followed by the raw image, sent the way Program.cs
+ *   paces the long input (100 bytes every 50 ms); the controller reads it a byte at a time
+ *   and echoes every byte, like the command processor does.
+ *
+ * Every run prints one JSON line with the throughput. The test fails if a framed upload does not
+ * arrive intact or the framed protocol is not faster than the line protocol on a clean link.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <BluetoothSerial.h>
+#include "BulkReceiver.h"
+#include "LoopbackLink.h"
+#include "SPIFFS.h"
+
+#include <random>
+#include <vector>
+
+BluetoothSerial bt_serial;
+StreamLogger stream_logger(Serial, bt_serial);
+BulkReceiver bulk_receiver;
+
+namespace
+{
+    const char *kTargetName = "/upload.bin";
+
+    // The PC end of the link
+    HostStream client;
+
+    struct Upload
+    {
+        std::vector<uint8_t> data;
+        bool done = false;
+        int status = -1; // 0 stored, otherwise failed
+    };
+
+    uint32_t read_u32(const uint8_t *p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    void write_u32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            out.push_back((uint8_t)(value >> (8 * i)));
+    }
+
+    // The SendBulk() of Program.cs
+    class FramedClient
+    {
+    public:
+        static const int Chunk = 480;
+        static const int AckTimeoutMs = 400;
+        static const int MaxRetries = 20;
+
+        int send(const std::vector<uint8_t> &data, const char *name)
+        {
+            std::vector<uint8_t> begin;
+            write_u32(begin, (uint32_t)data.size());
+            write_u32(begin, BulkReceiver::crc32(0, data.data(), data.size()));
+            begin.insert(begin.end(), name, name + strlen(name));
+
+            uint32_t acked = 0;
+            int window = 1;
+            int retries = 0;
+            uint8_t type;
+            std::vector<uint8_t> payload;
+            while (true)
+            {
+                writeFrame('B', begin);
+                if (waitReply(AckTimeoutMs * 3, type, payload) && type == 'A')
+                {
+                    acked = read_u32(payload.data());
+                    window = std::max(1, payload[4] | (payload[5] << 8));
+                    break;
+                }
+                if (++retries > MaxRetries)
+                    return -1;
+            }
+
+            uint32_t next = acked;
+            int duplicates = 0;
+            bool goneBack = false;
+            retries = 0;
+            while (acked < data.size())
+            {
+                while (next < data.size() && next - acked < (uint32_t)(window * Chunk))
+                {
+                    uint32_t length = std::min<uint32_t>(Chunk, data.size() - next);
+                    std::vector<uint8_t> chunk;
+                    write_u32(chunk, next);
+                    chunk.insert(chunk.end(), data.begin() + next, data.begin() + next + length);
+                    writeFrame('D', chunk);
+                    next += length;
+                }
+
+                if (!waitReply(AckTimeoutMs, type, payload))
+                {
+                    if (++retries > MaxRetries)
+                        return -1;
+                    next = acked;
+                    continue;
+                }
+                if (type == 'F')
+                    return payload[4];
+                if (type != 'A')
+                    continue;
+                uint32_t offset = read_u32(payload.data());
+                if (offset > acked)
+                {
+                    acked = offset;
+                    duplicates = 0;
+                    goneBack = false;
+                    retries = 0;
+                    next = std::max(next, acked);
+                }
+                else if (!goneBack && ++duplicates >= 2)
+                {
+                    next = acked;
+                    duplicates = 0;
+                    goneBack = true;
+                }
+            }
+
+            for (retries = 0; retries <= MaxRetries; ++retries)
+            {
+                writeFrame('E', {});
+                bool replied = waitReply(AckTimeoutMs * 3, type, payload);
+                while (replied && type == 'A')
+                    replied = waitReply(AckTimeoutMs * 3, type, payload);
+                if (replied && type == 'F')
+                    return payload[4];
+            }
+            return -1;
+        }
+
+    private:
+        std::vector<uint8_t> rx;
+
+        void writeFrame(uint8_t type, const std::vector<uint8_t> &payload)
+        {
+            std::vector<uint8_t> frame = {BulkReceiver::Sync0, BulkReceiver::Sync1, type,
+                                          (uint8_t)(payload.size() & 0xFF), (uint8_t)(payload.size() >> 8)};
+            frame.insert(frame.end(), payload.begin(), payload.end());
+            write_u32(frame, BulkReceiver::crc32(0, frame.data() + 2, 3 + payload.size()));
+            client.write(frame.data(), frame.size());
+        }
+
+        // The ExtractBulkFrames() of Program.cs, the text between the frames is skipped
+        bool extract(uint8_t &type, std::vector<uint8_t> &payload)
+        {
+            while (!rx.empty())
+            {
+                if (rx[0] != BulkReceiver::Sync0)
+                {
+                    rx.erase(rx.begin());
+                    continue;
+                }
+                if (rx.size() < 5)
+                    return false;
+                size_t length = rx[3] | (rx[4] << 8);
+                if (rx[1] != BulkReceiver::Sync1 || length > 8)
+                {
+                    rx.erase(rx.begin());
+                    continue;
+                }
+                if (rx.size() < 5 + length + 4)
+                    return false;
+                bool valid = BulkReceiver::crc32(0, rx.data() + 2, 3 + length) == read_u32(rx.data() + 5 + length);
+                if (valid)
+                {
+                    type = rx[2];
+                    payload.assign(rx.begin() + 5, rx.begin() + 5 + length);
+                    rx.erase(rx.begin(), rx.begin() + 5 + length + 4);
+                    return true;
+                }
+                rx.erase(rx.begin());
+            }
+            return false;
+        }
+
+        bool waitReply(int timeout_ms, uint8_t &type, std::vector<uint8_t> &payload)
+        {
+            unsigned long start = millis();
+            while (true)
+            {
+                while (client.available())
+                    rx.push_back((uint8_t)client.read());
+                if (extract(type, payload))
+                    return true;
+                if (millis() - start >= (unsigned long)timeout_ms)
+                    return false;
+                vTaskDelay(1); // the reader thread of Program.cs polls every 1 ms during the transfer
+            }
+        }
+    };
+
+    void framedClientTask(void *param)
+    {
+        Upload &upload = *static_cast<Upload *>(param);
+        upload.status = FramedClient().send(upload.data, kTargetName);
+        upload.done = true;
+        while (true)
+            vTaskDelay(1000);
+    }
+
+    uint8_t controlSum(const std::vector<uint8_t> &data)
+    {
+        uint8_t sum = 0;
+        for (uint8_t b : data)
+            sum += b;
+        return sum;
+    }
+
+    // The SendFile() of Program.cs with the image paced like the long input, 100 bytes every 50 ms
+    void lineClientTask(void *param)
+    {
+        Upload &upload = *static_cast<Upload *>(param);
+        char command[160];
+        snprintf(command, sizeof(command),
+                 "{\"command\":\"download_file_image\",\"storage_name\":\"%s\",\"storage_size\":%u,\"control_sum\":%u}\n",
+                 kTargetName + 1, (unsigned)upload.data.size(), (unsigned)controlSum(upload.data));
+        client.write(command);
+        for (size_t i = 0; i < upload.data.size(); i += 100)
+        {
+            client.write(upload.data.data() + i, std::min<size_t>(100, upload.data.size() - i));
+            vTaskDelay(50);
+        }
+        // the client reads the echo back, the upload is over when the controller answers or gives up
+        while (!upload.done)
+            vTaskDelay(1);
+        while (true)
+            vTaskDelay(1000);
+    }
+
+    // The controller side of "download_file_image": reads the image byte by byte, echoes every byte
+    class LineReceiver
+    {
+    public:
+        void poll(Stream &channel, Upload &upload)
+        {
+            if (!receiving)
+            {
+                while (channel.available())
+                {
+                    char c = (char)channel.read();
+                    if (c != '\n')
+                    {
+                        line += c;
+                        continue;
+                    }
+                    expected = number("\"storage_size\":");
+                    sum = (uint8_t)number("\"control_sum\":");
+                    receiving = true;
+                    lastByteMs = millis();
+                    break;
+                }
+                if (!receiving)
+                    return;
+            }
+            while (channel.available() && image.size() < expected)
+            {
+                uint8_t c = (uint8_t)channel.read();
+                image.push_back(c);
+                channel.write(c);
+                lastByteMs = millis();
+            }
+            if (image.size() == expected)
+            {
+                File file = SPIFFS.open(kTargetName, FILE_WRITE);
+                file.write(image.data(), image.size());
+                file.close();
+                upload.status = controlSum(image) == sum ? 0 : 1;
+                upload.done = true;
+            }
+            else if (millis() - lastByteMs > 2000)
+                upload.done = true; // the image never completes
+        }
+
+    private:
+        std::string line;
+        bool receiving = false;
+        size_t expected = 0;
+        uint8_t sum = 0;
+        std::vector<uint8_t> image;
+        unsigned long lastByteMs = 0;
+
+        unsigned long number(const char *key) const
+        {
+            size_t at = line.find(key);
+            return at == std::string::npos ? 0 : strtoul(line.c_str() + at + strlen(key), nullptr, 10);
+        }
+    };
+
+    struct Result
+    {
+        bool intact;
+        double bytes_per_s;
+    };
+
+    Result run(const char *protocol, size_t size, const LoopbackLink::Config &config)
+    {
+        SPIFFS.format();
+        Serial.output.clear();
+        Upload upload;
+        std::mt19937 random(size);
+        for (size_t i = 0; i < size; ++i)
+            upload.data.push_back((uint8_t)random());
+
+        bool framed = strcmp(protocol, "framed") == 0;
+        LoopbackLink link(client, bt_serial, config);
+        LineReceiver lineReceiver;
+        uint64_t start_us = host::now_us();
+        xTaskCreate(framed ? framedClientTask : lineClientTask, "client", 4096, &upload, 1, nullptr);
+
+        // the loop() of the controller, as far as the bulk upload goes
+        while (!upload.done)
+        {
+            if (framed)
+            {
+                if (bulk_receiver.claims(bt_serial, true))
+                    bulk_receiver.poll(bt_serial);
+            }
+            else
+                lineReceiver.poll(bt_serial, upload);
+            stream_logger.flush_if_due();
+            vTaskDelay(1);
+        }
+        double seconds = (host::now_us() - start_us) / 1e6;
+
+        std::string stored = SPIFFS.content_of(kTargetName);
+        Result result;
+        result.intact = upload.status == 0 && stored.size() == size &&
+                        memcmp(stored.data(), upload.data.data(), size) == 0;
+        result.bytes_per_s = result.intact ? size / seconds : 0.0;
+        printf("{\"protocol\":\"%s\",\"bytes\":%u,\"loss\":%.3f,\"latency_ms\":%u,\"link_bytes_per_s\":%u,"
+               "\"intact\":%s,\"seconds\":%.2f,\"bytes_per_s\":%.0f,\"packets\":%u,\"lost\":%u}\n",
+               protocol, (unsigned)size, config.loss, (unsigned)(config.latency_us / 1000),
+               (unsigned)config.bytes_per_s, result.intact ? "true" : "false", seconds, result.bytes_per_s,
+               (unsigned)link.get_stats().packets, (unsigned)link.get_stats().lost);
+
+        // the next run starts on a quiet link
+        vTaskDelay(3000);
+        while (client.available())
+            client.read();
+        while (bt_serial.available())
+            bt_serial.read();
+        return result;
+    }
+}
+
+int main()
+{
+    host::set_wall_clock(1760000000);
+    SPIFFS.begin(true);
+    // a SPIFFS page program per write plus the flash bandwidth, about 100 KB/s
+    SPIFFS.set_write_cost(500, 10000);
+
+    const size_t size = 32 * 1024;
+    LoopbackLink::Config clean;
+    Result framed = run("framed", size, clean);
+    Result line = run("line", size, clean);
+    CHECK(framed.intact);
+    CHECK(line.intact);
+    CHECK(framed.bytes_per_s > 4 * line.bytes_per_s);
+
+    for (double loss : {0.01, 0.05})
+    {
+        LoopbackLink::Config lossy;
+        lossy.loss = loss;
+        lossy.seed = (uint32_t)(loss * 1000);
+        CHECK(run("framed", size, lossy).intact);
+        run("line", size, lossy);
+    }
+
+    LoopbackLink::Config slow;
+    slow.latency_us = 80000;
+    slow.loss = 0.01;
+    CHECK(run("framed", size, slow).intact);
+
+    host::finish(test_result("BulkLoopbackTest"));
+}
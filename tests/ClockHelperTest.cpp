@@ -0,0 +1,96 @@
+/**
+ * @file ClockHelperTest.cpp
+ * @brief The clock commands of ClockHelper against the RTC stand-in: the local, UTC and offset times,
+ * the repeated hour of the DST switch and the build time set at a power loss.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <BluetoothSerial.h>
+#include "ClockHelper.h"
+
+BluetoothSerial bt_serial;
+StreamLogger stream_logger(Serial, bt_serial);
+ClockHelper runtime_clock_helper;
+
+namespace
+{
+    const char *kTimeZone = "CET-1CEST,M3.5.0,M10.5.0/3";
+
+    std::time_t at(int year, int month, int day, int hour = 0, int minute = 0, int second = 0)
+    {
+        return TimeZoneRules::days_from_civil(year, month, day) * TimeZoneRules::seconds_per_day +
+               hour * 3600 + minute * 60 + second;
+    }
+
+    // 2025-10-26 the clock goes back from 03:00 CEST to 02:00 CET, 02:45 happens at 00:45 and 01:45 UTC
+    void test_repeated_hour()
+    {
+        ClockHelper &clock = runtime_clock_helper;
+        host::set_wall_clock(at(2025, 10, 26, 0, 40)); // 02:40 CEST
+        CHECK(clock.set_time_zone(kTimeZone, false)); // the table starts the year before the clock
+        CHECK(clock.set_controller_clock("2025-10-26T02:45:00"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 0, 45));
+
+        host::set_wall_clock(at(2025, 10, 26, 1, 40)); // 02:40 CET, the second time
+        CHECK(clock.set_controller_clock("2025-10-26T02:45:00"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 1, 45));
+
+        // an unambiguous time is not pulled towards the clock
+        CHECK(clock.set_controller_clock("2025-10-26T09:00:00"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 8));
+    }
+
+    void test_explicit_offset()
+    {
+        ClockHelper &clock = runtime_clock_helper;
+        host::set_wall_clock(at(2025, 10, 26, 1, 40));
+        CHECK(clock.set_time_zone(kTimeZone, false));
+
+        CHECK(clock.set_controller_clock("2025-10-26T02:45:00Z"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 2, 45));
+        CHECK(clock.set_controller_clock("2025-10-26T02:45:00+02:00"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 0, 45));
+        CHECK(clock.set_controller_clock("2025-10-26T02:45:00+01:00"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 1, 45));
+        CHECK(clock.set_controller_clock("2025-10-25T22:45:00-0330"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 2, 15));
+
+        // a malformed offset leaves the clock alone
+        CHECK(!clock.set_controller_clock("2025-10-26T05:00:00+1"));
+        CHECK(!clock.set_controller_clock("2025-10-26T05:00:00 CET"));
+        CHECK(!clock.set_controller_clock("2025-10-26T05:00:00+25:00"));
+        CHECK_EQ(std::time(nullptr), at(2025, 10, 26, 2, 15));
+    }
+
+    // The RTC lost power: it gets the build time, which is the local wall clock of the stored time zone
+    void test_build_time_after_power_loss()
+    {
+        ClockHelper persisted;
+        CHECK(persisted.set_time_zone(kTimeZone, true));
+
+        ClockHelper booted;
+        RTC_DS3231::power_lost() = true;
+        CHECK(booted.delayed_setup());
+        booted.restore_time_zone();
+        RTC_DS3231::power_lost() = false;
+
+        // the sketch and this test are built within minutes, the offset of the zone is an hour or two
+        std::time_t build_local = DateTime(F(__DATE__), F(__TIME__)).unixtime();
+        std::time_t local = booted.utc_to_local(std::time(nullptr));
+        CHECK(local > build_local - 600 && local < build_local + 600);
+        CHECK(std::time(nullptr) < build_local - 1800);
+    }
+}
+
+int main()
+{
+    test_repeated_hour();
+    test_explicit_offset();
+    test_build_time_after_power_loss();
+    host::finish(test_result("ClockHelperTest"));
+}
@@ -0,0 +1,180 @@
+/**
+ * @file CoalescingWriterBench.cpp
+ * @brief The output of loop() written straight into the link against through CoalescingWriter.
+ *
+ * The link is a fake stream that charges a fixed cost per write, the airtime and the overhead
+ * of an SPP packet, plus a little per byte. The same workload runs both ways on the virtual clock:
+ * the per-character echoes of the input at the serial line rate, the heartbeat dots, and the
+ * prefix, payload and result prints of every command, which the loop() flushes right away.
+ *
+ * Every run prints one JSON line: the writes, the bytes, the time spent writing and the longest
+ * a byte waited. The test fails if the coalesced output differs, is not at least 10 times cheaper,
+ * or a byte waits longer than the deadline and a loop pass.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <Arduino.h>
+#include <BluetoothSerial.h>
+#include "CoalescingWriter.h"
+#include "StreamLogger.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint64_t kPerWriteUs = 250; // an SPP packet
+    const uint64_t kPerByteNs = 1000;
+    const size_t kMtu = 990;
+    const unsigned long kDeadlineMs = 10;
+    const int kPasses = 20000;       // loop() passes of 1 ms
+    const int kCharsPerPass = 11;    // 115200 baud
+    const int kHeartbeatPasses = 50;
+    const int kCommandPasses = 20;   // a command line every 20 ms
+
+    // The link, every write costs a packet, the bytes go out when the write returns
+    class PacketStream : public Print
+    {
+    public:
+        std::string content;
+        std::vector<uint64_t> sent_us; // per byte
+        uint32_t writes = 0;
+        uint64_t busy_us = 0;
+
+        size_t write(uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t *data, size_t size) override
+        {
+            uint64_t cost_us = kPerWriteUs + size * kPerByteNs / 1000;
+            host::consume_us(cost_us);
+            writes++;
+            busy_us += cost_us;
+            content.append((const char *)data, size);
+            sent_us.insert(sent_us.end(), size, host::now_us());
+            return size;
+        }
+    };
+
+    // The writer of the firmware, remembers when every byte was written
+    class Source
+    {
+    public:
+        std::vector<uint64_t> written_us;
+
+        explicit Source(Print &out) : out(out) {}
+
+        void write(const char *text)
+        {
+            written_us.insert(written_us.end(), strlen(text), host::now_us());
+            out.write(text);
+        }
+        void write(char c)
+        {
+            written_us.push_back(host::now_us());
+            out.write((uint8_t)c);
+        }
+
+    private:
+        Print &out;
+    };
+
+    struct Result
+    {
+        uint32_t writes;
+        uint64_t busy_us;
+        uint64_t max_wait_us;
+    };
+
+    // The output of the loop() passes, writer is null when the output goes straight into the link
+    Result run(const char *mode, PacketStream &link, Print &out, CoalescingWriter *writer)
+    {
+        Source source(out);
+        const std::string command = "{\"command\":\"path_player_switch\",\"player\":\"on\"}";
+        size_t echoed = command.size(); // nothing is coming in
+        for (int pass = 0; pass < kPasses; ++pass)
+        {
+            if (pass % kHeartbeatPasses == 0)
+                source.write(".");
+            if (pass % kCommandPasses == 0)
+                echoed = 0; // the next command line starts coming in
+            bool receiving = echoed < command.size();
+            for (int i = 0; i < kCharsPerPass && echoed < command.size(); ++i)
+                source.write(command[echoed++]);
+            if (receiving && echoed == command.size())
+            {
+                source.write("main.cpp.loop():\t Received a message: ");
+                source.write(command.c_str());
+                source.write("\n");
+                source.write("main.cpp.loop():\t The command processing returns 1 \n\n");
+                if (writer != nullptr)
+                    writer->flush();
+            }
+            if (writer != nullptr)
+                writer->flush_if_due();
+            vTaskDelay(1);
+        }
+        if (writer != nullptr)
+            writer->flush();
+
+        Result result = {link.writes, link.busy_us, 0};
+        CHECK_EQ(link.sent_us.size(), source.written_us.size());
+        for (size_t i = 0; i < link.sent_us.size() && i < source.written_us.size(); ++i)
+            result.max_wait_us = std::max(result.max_wait_us, link.sent_us[i] - source.written_us[i]);
+        std::printf("{\"mode\":\"%s\",\"per_write_us\":%u,\"writes\":%u,\"bytes\":%u,\"busy_ms\":%.1f,"
+                    "\"bytes_per_write\":%.1f,\"max_wait_ms\":%.2f}\n",
+                    mode, (unsigned)kPerWriteUs, (unsigned)link.writes, (unsigned)link.content.size(),
+                    link.busy_us / 1000.0, (double)link.content.size() / std::max<uint32_t>(1, link.writes),
+                    result.max_wait_us / 1000.0);
+        return result;
+    }
+
+    // print_output_stats() reports every channel with its own flush reasons
+    void test_output_stats()
+    {
+        BluetoothSerial bt;
+        StreamLogger logger(Serial, bt);
+        Serial.output.clear();
+        logger.bt_out.print("a");
+        logger.bt_out.flush();
+        logger.bt_out.print(std::string(kMtu, 'b').c_str());
+        logger.serial_out.print("c");
+        vTaskDelay(kDeadlineMs);
+        logger.flush_if_due();
+        logger.print_output_stats();
+        logger.flush();
+        CHECK(Serial.output.find("Output serial: 1 writes / 1 bytes (flushes full 0, deadline 1, explicit 0)") !=
+              std::string::npos);
+        CHECK(Serial.output.find("Output BT: 2 writes / 991 bytes (flushes full 0, deadline 0, explicit 1)") !=
+              std::string::npos);
+    }
+}
+
+int main()
+{
+    PacketStream direct;
+    Result plain = run("direct", direct, direct, nullptr);
+
+    PacketStream link;
+    CoalescingWriter writer(link, kMtu, kDeadlineMs);
+    Result coalesced = run("coalesced", link, writer, &writer);
+
+    CHECK(link.content == direct.content);
+    CHECK(coalesced.writes * 10 < plain.writes);
+    CHECK(coalesced.busy_us * 10 < plain.busy_us);
+    CHECK(coalesced.max_wait_us <= (kDeadlineMs + 2) * 1000);
+
+    CoalescingWriter::Stats stats = writer.get_stats();
+    CHECK_EQ(stats.writes, link.writes);
+    CHECK_EQ(stats.bytes, link.content.size());
+    CHECK_EQ(stats.flushes_full + stats.flushes_deadline + stats.flushes_explicit, stats.writes);
+    CHECK(stats.flushes_deadline > 0);
+    CHECK(stats.flushes_explicit > 0);
+
+    test_output_stats();
+    return test_result("CoalescingWriterBench");
+}
@@ -0,0 +1,20 @@
+/**
+ * @file CronLiteralMalformed.cpp
+ * @brief Must not build: the hour 24 of the literal fails the "malformed cron literal" static_assert.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "CronSpec.h"
+
+static const char *take(const CronLiteral &schedule)
+{
+    return schedule.text;
+}
+
+int main()
+{
+    return take("0 24 * * *"_cron) != nullptr;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file CronLiteralTest.cpp
+ * @brief The _cron literals in C++14, the oldest standard CronSpec.h supports, and their tasks.
+ *
+ * The malformed literal is CronLiteralMalformed.cpp, the test passes if it does not build.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <BluetoothSerial.h>
+#include "ScheduledTask.h"
+
+BluetoothSerial bt_serial;
+StreamLogger stream_logger(Serial, bt_serial);
+
+namespace
+{
+    constexpr auto every_evening = "0 21 * * *"_cron;
+    // the masks are template constants, usable where only a constant is
+    static_assert(every_evening.spec.hours == 1u << 21 && every_evening.length == 10, "");
+
+    bool same_spec(const CronSpec &a, const CronSpec &b)
+    {
+        return a.seconds == b.seconds && a.minutes == b.minutes && a.hours == b.hours &&
+               a.daysOfMonth == b.daysOfMonth && a.months == b.months && a.daysOfWeek == b.daysOfWeek &&
+               a.valid == b.valid;
+    }
+
+    void test_literal()
+    {
+        // one text per distinct literal, shared by every use
+        CHECK(every_evening.text == "0 21 * * *"_cron.text);
+        CHECK(std::string(every_evening.text) == "0 21 * * *");
+        CHECK(same_spec(every_evening.spec, CronSpec::parse("0 21 * * *", 10)));
+        CHECK(same_spec("30 0 21 * * 0,7"_cron.spec, CronSpec::parse("30 0 21 * * 0,7", 15)));
+    }
+
+    void test_task()
+    {
+        ScheduledTask literal(every_evening, "{\"command\":\"path_player_switch\",\"player\":\"on\"}");
+        CHECK_EQ(literal.getRuleCount(), 1);
+        CHECK(literal.getRuleSchedule(0) == "0 21 * * *");
+        CHECK(literal.getSchedule() == "0 21 * * *");
+        CHECK(literal.shouldRunAt(1709413200)); // 2024-03-02 21:00:00
+        CHECK(!literal.shouldRunAt(1709413200 + 60));
+
+        // a runtime rule merged into the literal task is listed after it
+        ScheduledTask parsed("0 7 * * *", "{\"command\":\"path_player_switch\",\"player\":\"on\"}");
+        CHECK(literal.mergeRules(parsed));
+        CHECK(literal.getSchedule() == "0 21 * * *; 0 7 * * *");
+        CHECK(literal.getRuleSchedule(1) == "0 7 * * *");
+    }
+}
+
+int main()
+{
+    test_literal();
+    test_task();
+    return test_result("CronLiteralTest");
+}
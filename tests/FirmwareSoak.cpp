@@ -0,0 +1,493 @@
+/**
+ * @file FirmwareSoak.cpp
+ * @brief The soak run of the whole firmware: setup() and loop() of main.cpp on the virtual clock.
+ *
+ * main.cpp is built unchanged against the host stand-ins (tests/host/): the serial ports, SPIFFS,
+ * the RTC, FreeRTOS, the chip info, and the command processor with the cost of its commands.
+ * Before the boot SPIFFS gets a crontab of the given size and a time zone with the DST switches,
+ * setup() restores them like after a power cycle. The loopTask then calls loop() until the virtual
+ * time is over, the scheduler and the dispatcher workers run in their own tasks meanwhile;
+ * a virtual hour takes a few seconds.
+ *
+ * Two clients drive the input, one command in flight each, like the soak mode of Program.cs:
+ * the BT client replays the trace, resending the busy commands after retry_ms, the Serial client
+ * an operator listing the tasks and the agenda now and then. A command is sent at its link rate,
+ * its latency runs until the response is written into the link. The trace is a file in the format
+ * of Program.cs ("@<ms> <command>" lines) or "synthetic": the player switches in bursts,
+ * the clock syncs, the crontab changes saved into SPIFFS. A set_date_time with "now" is sent with
+ * the time of the client and its UTC offset as its second turns, a busy one is resent with the time
+ * of the resend: the time has whole seconds, a sync sent mid-second steps the clock by the fraction,
+ * which the scheduler would report as lateness.
+ *
+ *     firmware_soak [synthetic|<trace file>] [<virtual minutes>] [<crontab tasks>]
+ *
+ * The METRICS lines of the firmware (LoopMetrics.h) are printed as they come, the run ends with
+ *
+ *     SOAK {"trace":..,"virtual_s":..,"wall_s":..,"throughput_per_s":..,
+ *           "bt":{"sent":..,"responses":..,"busy":..,"throttled":..,"timeouts":..,"failed":..,
+ *                 "latency_ms":{"p50":..,"p90":..,"p99":..,"max":..}},"serial":{...},
+ *           "scheduler":{"fires":..,"evaluated":..,"completed":..,"skipped":..,"folded":..,"deduped":..,
+ *                        "superseded":..,"dropped":..,"lateness_us":{"last":..,"max":..}},
+ *           "heap":{"free":..,"min_free":..,"growth":..,"growth_after_warmup":..},
+ *           "log_bytes":{"serial":..,"bt":..,"per_hour":..},"metrics_lines":..}
+ *
+ * "fires" are the fires of the crontab within the run (ScheduleManager::agenda()), "evaluated" the fires
+ * the scheduler handled meanwhile: queued, skipped by the SKIP policy, folded into a queued QUEUE run,
+ * deduplicated within a tick, superseded in a catch-up or dropped by a full queue. The two have to be
+ * equal, an extra or a lost fire breaks it, and every queued fire has to be executed.
+ * The lateness includes the clock steps of the syncs, the boot sync to the whole seconds of the RTC
+ * steps it by up to a second.
+ *
+ * The run fails if a command times out or is refused for good, a fire of the crontab is lost,
+ * a tick is missed, or the heap keeps growing after the first interval.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <Arduino.h>
+#include <ESP.h>
+#include <BluetoothSerial.h>
+#include "SPIFFS.h"
+#include "ClockHelper.h"
+#include "CommandProcessor.h"
+#include "ScheduleManager.h"
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+extern BluetoothSerial bt_serial;
+extern CommandProcessor command_processor;
+
+namespace
+{
+    const std::time_t kStart = 1761350400; // 2025-10-25, the clocks fall back the next night
+    const char *kTimeZone = "CET-1CEST,M3.5.0,M10.5.0/3";
+    const uint64_t kReplyTimeoutUs = 5000000;
+    const int kMaxAttempts = 10;   // busy replies before the command counts as refused
+    const uint32_t kGapMs = 50;    // between the commands of the trace without a delay
+    const char *kNow = "\"date_time\":\"now\""; // replaced by the time of the client when sent
+    const uint32_t kLatencyBuckets = 50001; // 0.1 ms each, up to the timeout
+
+    struct Command
+    {
+        uint32_t delay_ms;
+        std::string text;
+    };
+
+    // The latencies in 0.1 ms buckets, allocated before the boot so the run never grows the heap
+    class Latencies
+    {
+    public:
+        Latencies() : buckets(kLatencyBuckets) {}
+
+        void add(uint64_t us)
+        {
+            buckets[std::min<uint64_t>(us / 100, kLatencyBuckets - 1)]++;
+            count++;
+        }
+        double percentile_ms(uint32_t per_cent) const
+        {
+            uint32_t rank = (uint32_t)(((uint64_t)count * per_cent + 99) / 100);
+            uint32_t seen = 0;
+            for (uint32_t i = 0; i < kLatencyBuckets && count != 0; ++i)
+                if ((seen += buckets[i]) >= rank)
+                    return (i + 1) / 10.0;
+            return 0;
+        }
+
+    private:
+        std::vector<uint32_t> buckets;
+        uint32_t count = 0;
+    };
+
+    // One command in flight, the responses read from the output of the link
+    class Client
+    {
+    public:
+        uint32_t sent = 0, responses = 0, busy = 0, throttled = 0, refused = 0, timeouts = 0, failed = 0;
+        uint64_t log_bytes = 0;
+        Latencies latencies;
+
+        Client(HostStream &link, uint32_t bytes_per_s, const std::vector<Command> &trace)
+            : link(link), bytes_per_s(bytes_per_s), trace(trace)
+        {
+            line.reserve(1024);
+            received.reserve(1024);
+            command.reserve(256);
+            link.on_write = [this](const uint8_t *data, size_t size) { on_output(data, size); };
+        }
+
+        // Between the loop() passes: the next command, the resend of a busy one, the timeout
+        void step()
+        {
+            uint64_t now = host::now_us();
+            if (!in_flight)
+            {
+                if (now >= next_send_us)
+                    send_next();
+            }
+            else if (resend_us != 0 && now >= resend_us)
+                transmit();
+            else if (now >= sent_us + kReplyTimeoutUs)
+            {
+                timeouts++;
+                finish();
+            }
+        }
+
+        // The lines the firmware writes into the link, the METRICS lines are handed to on_metrics
+        std::function<void(const char *)> on_metrics;
+
+    private:
+        HostStream &link;
+        uint32_t bytes_per_s;
+        const std::vector<Command> &trace;
+        size_t next = 0;
+        bool in_flight = false;
+        int attempt = 0;
+        const std::string *pattern = nullptr; // the trace text of the command in flight
+        std::string command;
+        std::string line;
+        std::string received; // the last "Received a message" of the link
+        uint64_t next_send_us = 0;
+        uint64_t sent_us = 0;
+        uint64_t resend_us = 0;
+
+        void send_next()
+        {
+            bool clock_sync = trace[next].text.find(kNow) != std::string::npos;
+            uint64_t second_us = host::now_us() % 1000000;
+            if (clock_sync && second_us != 0)
+            {
+                // the time has whole seconds, sent mid-second it would step the clock by the fraction
+                next_send_us = host::now_us() + 1000000 - second_us;
+                return;
+            }
+            pattern = &trace[next].text;
+            next = (next + 1) % trace.size();
+            in_flight = true;
+            attempt = 0;
+            sent_us = host::now_us();
+            transmit();
+        }
+
+        void transmit()
+        {
+            size_t now_at = pattern->find(kNow);
+            if (now_at != std::string::npos)
+            {
+                // the time of this very send, a resend waits for the next whole second as well
+                uint64_t second_us = host::now_us() % 1000000;
+                if (second_us != 0)
+                {
+                    resend_us = host::now_us() + 1000000 - second_us;
+                    return;
+                }
+                command = *pattern;
+                command.replace(now_at + 13, 3, client_time());
+            }
+            else
+                command = *pattern;
+            attempt++;
+            sent++;
+            resend_us = 0;
+            uint64_t at = host::now_us();
+            for (size_t i = 0; i <= command.size(); ++i)
+            {
+                uint8_t c = i < command.size() ? command[i] : '\n';
+                link.inject(&c, 1, at + i * 1000000 / bytes_per_s);
+            }
+        }
+
+        void finish()
+        {
+            in_flight = false;
+            resend_us = 0;
+            uint32_t delay_ms = trace[next].delay_ms;
+            next_send_us = host::now_us() + (uint64_t)(delay_ms != 0 ? delay_ms : kGapMs) * 1000;
+        }
+
+        void on_output(const uint8_t *data, size_t size)
+        {
+            log_bytes += size;
+            for (size_t i = 0; i < size; ++i)
+            {
+                if (data[i] != '\n')
+                {
+                    if (line.size() < line.capacity())
+                        line += (char)data[i];
+                    continue;
+                }
+                on_line();
+                line.clear();
+            }
+        }
+
+        void on_line()
+        {
+            // the echoes of the other channel may come in front of a line
+            static const std::string prefix = "main.cpp.loop():\t Received a message: ";
+            size_t metrics = line.find("METRICS {");
+            size_t message = line.find(prefix);
+            if (metrics != std::string::npos)
+            {
+                if (on_metrics)
+                    on_metrics(line.c_str() + metrics);
+            }
+            else if (message != std::string::npos)
+                received.assign(line, message + prefix.size(), std::string::npos);
+            else if (line.find("\"status\":\"throttled\"") != std::string::npos)
+                throttled++; // the bytes stay, the command runs later, nothing to resend
+            else if (!in_flight || resend_us != 0)
+                return;
+            else if (line.find("\"status\":\"too_long\"") != std::string::npos)
+            {
+                refused++;
+                finish();
+            }
+            else if (line.find("\"status\":\"busy\"") != std::string::npos)
+            {
+                busy++;
+                if (attempt == kMaxAttempts)
+                {
+                    refused++;
+                    finish();
+                    return;
+                }
+                size_t at = line.find("\"retry_ms\":");
+                uint32_t retry_ms = at == std::string::npos ? 1 : std::atoi(line.c_str() + at + 11);
+                resend_us = host::now_us() + std::max<uint32_t>(1, retry_ms) * 1000;
+            }
+            else if (line.find("The command processing returns") != std::string::npos && received == command)
+            {
+                latencies.add(host::now_us() - sent_us);
+                responses++;
+                failed += line.find("returns 0") != std::string::npos;
+                finish();
+            }
+        }
+
+        // The clock of the client with its UTC offset, like Program.cs sends it;
+        // the controller's own clock drifts with every sync it truncates
+        static std::string client_time()
+        {
+            std::time_t utc = kStart + host::now_us() / 1000000;
+            std::time_t local = runtime_clock_helper.utc_to_local(utc);
+            int offset_min = (int)(local - utc) / 60;
+            std::tm tm;
+            gmtime_r(&local, &tm);
+            char text[32];
+            size_t length = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &tm);
+            snprintf(text + length, sizeof(text) - length, "%c%02d:%02d", offset_min < 0 ? '-' : '+',
+                     std::abs(offset_min) / 60, std::abs(offset_min) % 60);
+            return text;
+        }
+    };
+
+    std::string player_switch(bool on)
+    {
+        return std::string("{\"command\":\"path_player_switch\",\"player\":\"") + (on ? "on" : "off") + "\"}";
+    }
+
+    // The client of Program.cs: the player switches in bursts with a clock sync now and then,
+    // plus a task added and deleted again, the crontab is saved into SPIFFS both times
+    std::vector<Command> synthetic_trace(int tasks)
+    {
+        std::vector<Command> trace;
+        for (int i = 0; i < 100; i++)
+        {
+            if (i % 25 == 0)
+                trace.push_back({1000, "{\"command\":\"set_date_time\",\"date_time\":\"now\"}"});
+            else if (i == 50)
+                trace.push_back({1000, "{\"command\":\"add_task\",\"schedule\":\"0 7 * * *\"}"});
+            else if (i == 51)
+                trace.push_back({200, "{\"command\":\"delete_task\",\"index\":" + std::to_string(tasks) + "}"});
+            else
+                trace.push_back({(uint32_t)(i % 5 == 0 ? 200 : 0), player_switch(i % 2 == 0)});
+        }
+        return trace;
+    }
+
+    std::vector<Command> operator_trace()
+    {
+        return {{15000, "{\"command\":\"get_agenda\",\"hours\":1}"}, {15000, "{\"command\":\"list_tasks\"}"}};
+    }
+
+    // The "@<ms> <command>" lines of Program.cs, the empty lines and the '#' comments skipped
+    std::vector<Command> load_trace(const char *path)
+    {
+        std::vector<Command> trace;
+        std::ifstream file(path);
+        std::string text;
+        while (std::getline(file, text))
+        {
+            size_t first = text.find_first_not_of(" \t\r");
+            size_t last = text.find_last_not_of(" \t\r");
+            if (first == std::string::npos || text[first] == '#')
+                continue;
+            text = text.substr(first, last - first + 1);
+            uint32_t delay_ms = 0;
+            if (text[0] == '@')
+            {
+                size_t space = text.find(' ');
+                if (space == std::string::npos)
+                    continue;
+                delay_ms = std::atoi(text.c_str() + 1);
+                text = text.substr(text.find_first_not_of(' ', space));
+            }
+            trace.push_back({delay_ms, text});
+        }
+        return trace;
+    }
+
+    // The crontab of the controller: mostly daily tasks, every 20th fires every minute
+    void write_crontab(int tasks)
+    {
+        File file = SPIFFS.open("/crontab", FILE_WRITE);
+        for (int i = 0; i < tasks; ++i)
+        {
+            char line[128];
+            if (i % 20 == 0)
+                snprintf(line, sizeof(line), "%d * * * * *", (i / 20) % 60);
+            else
+                snprintf(line, sizeof(line), "%d %d * * *", i % 60, (i * 7) % 24);
+            std::string config = player_switch(i % 2 == 0);
+            config.insert(config.size() - 1, ",\"task\":" + std::to_string(i));
+            file.println((std::string(line) + (i % 3 == 0 ? " !queue" : "") + " |" + config).c_str());
+        }
+        file.close();
+        file = SPIFFS.open("/timezone", FILE_WRITE);
+        file.print(kTimeZone);
+        file.close();
+    }
+
+    void print_client(const char *name, const Client &client)
+    {
+        const Latencies &l = client.latencies;
+        std::printf("\"%s\":{\"sent\":%u,\"responses\":%u,\"busy\":%u,\"throttled\":%u,\"refused\":%u,"
+                    "\"timeouts\":%u,\"failed\":%u,\"latency_ms\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}}",
+                    name, (unsigned)client.sent, (unsigned)client.responses, (unsigned)client.busy,
+                    (unsigned)client.throttled, (unsigned)client.refused, (unsigned)client.timeouts,
+                    (unsigned)client.failed, l.percentile_ms(50), l.percentile_ms(90), l.percentile_ms(99),
+                    l.percentile_ms(100));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace_name = argc > 1 ? argv[1] : "synthetic";
+    int minutes = argc > 2 ? std::atoi(argv[2]) : 60;
+    int tasks = argc > 3 ? std::atoi(argv[3]) : 200;
+    std::vector<Command> trace = std::string(trace_name) == "synthetic" ? synthetic_trace(tasks) : load_trace(trace_name);
+    if (trace.empty() || minutes <= 0 || tasks < 0)
+    {
+        std::printf("usage: firmware_soak [synthetic|<trace file>] [<virtual minutes>] [<crontab tasks>]\n");
+        return 2;
+    }
+    std::vector<Command> operator_commands = operator_trace();
+
+    host::set_wall_clock(kStart);
+    SPIFFS.begin(true);
+    SPIFFS.set_write_cost(500, 10000); // as in BulkLoopbackTest
+    write_crontab(tasks);
+    Serial.rx_capacity = 256; // the UART RX buffer, no flow control
+
+    Client bt_client(bt_serial, 20000, trace);
+    Client serial_client(Serial, 11520, operator_commands);
+    uint32_t metrics_lines = 0;
+    uint32_t warmup_free_heap = 0;
+    serial_client.on_metrics = [&](const char *line)
+    {
+        std::printf("%s\n", line);
+        if (metrics_lines++ == 0)
+            warmup_free_heap = ESP.getFreeHeap();
+    };
+
+    auto run_firmware = [&]()
+    {
+        bt_client.step();
+        serial_client.step();
+        loop();
+    };
+    // The fires the scheduler has handled so far, whatever became of them
+    auto evaluated_fires = []()
+    {
+        CommandDispatcher::Stats stats = schedule_manager.getDispatchStats();
+        return (size_t)stats.submitted + stats.deferred + stats.skippedOverlap + stats.droppedFull +
+               schedule_manager.getDedupedDispatches() + schedule_manager.getSupersededFires();
+    };
+    // Mid-second of the controller clock, the tick of the current second has run, the next is ahead
+    auto run_to_mid_second = [&]()
+    {
+        struct timeval now;
+        for (gettimeofday(&now, nullptr); now.tv_usec < 200000 || now.tv_usec > 800000; gettimeofday(&now, nullptr))
+            run_firmware();
+        return runtime_clock_helper.utc_to_local(now.tv_sec);
+    };
+
+    auto wall_start = std::chrono::steady_clock::now();
+    setup();
+    uint32_t boot_free_heap = ESP.getFreeHeap();
+    std::time_t first_local = run_to_mid_second() + 1;
+    size_t evaluated_before = evaluated_fires();
+    uint64_t end_us = host::now_us() + (uint64_t)minutes * 60 * 1000000;
+    while (host::now_us() < end_us)
+        run_firmware();
+    std::time_t last_local = run_to_mid_second();
+    size_t evaluated = evaluated_fires() - evaluated_before;
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    double virtual_s = host::now_us() / 1e6;
+    CommandDispatcher::Stats dispatch = schedule_manager.getDispatchStats();
+    // the fires of the crontab within the run
+    size_t expected_fires = schedule_manager.agenda(first_local, last_local, "",
+                                                    [](std::time_t, int, const ScheduledTask &) { return true; });
+    uint32_t free_heap = ESP.getFreeHeap();
+    int growth_after_warmup = metrics_lines != 0 ? (int)(warmup_free_heap - free_heap) : 0;
+    std::printf("SOAK {\"trace\":\"%s\",\"virtual_s\":%.0f,\"wall_s\":%.1f,\"crontab_tasks\":%d,"
+                "\"throughput_per_s\":%.2f,",
+                trace_name, virtual_s, wall_s, tasks,
+                (bt_client.responses + serial_client.responses) / virtual_s);
+    print_client("bt", bt_client);
+    std::printf(",");
+    print_client("serial", serial_client);
+    std::printf(",\"scheduler\":{\"fires\":%u,\"evaluated\":%u,\"completed\":%u,\"skipped\":%u,\"folded\":%u,"
+                "\"deduped\":%u,\"superseded\":%u,\"dropped\":%u,\"lateness_us\":{\"last\":%u,\"max\":%u}},"
+                "\"heap\":{\"free\":%u,\"min_free\":%u,\"growth\":%d,\"growth_after_warmup\":%d},"
+                "\"log_bytes\":{\"serial\":%llu,\"bt\":%llu,\"per_hour\":%.0f},\"metrics_lines\":%u}\n",
+                (unsigned)expected_fires, (unsigned)evaluated, (unsigned)dispatch.completed,
+                (unsigned)dispatch.skippedOverlap, (unsigned)dispatch.deferred,
+                (unsigned)schedule_manager.getDedupedDispatches(), (unsigned)schedule_manager.getSupersededFires(),
+                (unsigned)dispatch.droppedFull,
+                (unsigned)schedule_manager.getLastLatenessUs(), (unsigned)schedule_manager.getMaxLatenessUs(),
+                (unsigned)free_heap, (unsigned)ESP.getMinFreeHeap(), (int)(boot_free_heap - free_heap),
+                growth_after_warmup, (unsigned long long)serial_client.log_bytes,
+                (unsigned long long)bt_client.log_bytes,
+                (serial_client.log_bytes + bt_client.log_bytes) * 3600.0 / virtual_s, (unsigned)metrics_lines);
+
+    CHECK_EQ(bt_client.timeouts + serial_client.timeouts, 0);
+    CHECK_EQ(bt_client.refused + serial_client.refused, 0);
+    CHECK(bt_client.responses > 0 && serial_client.responses > 0);
+    CHECK_EQ(command_processor.get_stats().failed, 0);
+    CHECK(expected_fires > 0);
+    CHECK_EQ(evaluated, expected_fires);
+    // every queued fire executed, but the one the worker may be running
+    CHECK(dispatch.submitted - dispatch.completed - dispatch.queueDepth <= 1);
+    CHECK_EQ(dispatch.droppedFull, 0);
+    // the syncs step the clock (the boot sync to the whole seconds of the RTC, a sync that ran late),
+    // the scheduler counts a step forward as lateness; a second late would be a missed tick
+    CHECK(schedule_manager.getMaxLatenessUs() < 1000000);
+    CHECK(metrics_lines >= (uint32_t)minutes - 1);
+    CHECK(growth_after_warmup <= 4096);
+    host::finish(test_result("FirmwareSoak"));
+}
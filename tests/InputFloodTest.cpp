@@ -0,0 +1,166 @@
+/**
+ * @file InputFloodTest.cpp
+ * @brief The scheduler lateness while a client floods the BT input, with and without the input limits.
+ *
+ * The real ScheduleManager fires a command every second, its worker executes it under the command
+ * lock the loop() shares (see main.cpp). The loopTask runs the loop() input handling: both channels
+ * polled through InputChannel, every admitted command executed under the lock with its CPU cost.
+ * The flooding client sends the commands back to back at the BT link rate, a Serial client sends
+ * a burst of lines at 115200 baud into the 256 byte UART RX buffer.
+ *
+ * Every run prints one JSON line. The test fails if, with the firmware limits, a scheduled command
+ * runs more than a few commands late, a loop() pass takes longer than its command budget,
+ * or the Serial input loses bytes. The run without the limits shows what they prevent.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <BluetoothSerial.h>
+#include "ClockHelper.h"
+#include "InputChannel.h"
+#include "ScheduleManager.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+BluetoothSerial bt_serial;
+StreamLogger stream_logger(Serial, bt_serial);
+ClockHelper runtime_clock_helper;
+ScheduleManager schedule_manager;
+
+namespace
+{
+    const std::time_t kStart = 1760000000;
+    const uint64_t kCommandCostUs = 5000; // a command of the command processor
+    const uint32_t kBtBytesPerS = 20000;  // the SPP throughput
+    const int kRunSeconds = 20;
+    const char *kTickCommand = "{\"command\":\"tick\"}";
+    const char *kFloodLine = "{\"command\":\"get_status\"}\n";
+    const char *kSerialLine = "{\"command\":\"add_task\",\"schedule\":\"0 7 * * *\"}\n";
+    const int kSerialLines = 200;
+
+    SemaphoreHandle_t command_mutex;
+    std::vector<uint64_t> tick_runs_us; // when the scheduled commands started
+
+    class NullPrint : public Print
+    {
+    public:
+        size_t write(uint8_t) override { return 1; }
+        size_t write(const uint8_t *, size_t size) override { return size; }
+    };
+    NullPrint echo;
+
+    // The processCommandFunc of main.cpp with the cost of the command
+    bool process_command(std::string &config)
+    {
+        xSemaphoreTake(command_mutex, portMAX_DELAY);
+        if (config == kTickCommand)
+            tick_runs_us.push_back(host::now_us());
+        host::consume_us(kCommandCostUs);
+        xSemaphoreGive(command_mutex);
+        return true;
+    }
+
+    size_t count_of(const std::string &text, const std::string &what)
+    {
+        size_t count = 0;
+        for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1))
+            ++count;
+        return count;
+    }
+
+    struct Result
+    {
+        uint64_t max_gap_us; // between the scheduled commands, 1 s if nothing delays them
+        uint64_t max_pass_us;
+        uint32_t serial_dropped;
+    };
+
+    Result run(const char *name, const InputChannel::Limits &bt_limits, const InputChannel::Limits &serial_limits)
+    {
+        HostStream flood;
+        HardwareSerial uart;
+        uart.rx_capacity = 256;
+        uint64_t start = host::now_us();
+        size_t line = strlen(kFloodLine);
+        for (uint64_t sent = 0; sent * 1000000 < (uint64_t)kRunSeconds * kBtBytesPerS * 1000000; sent += line)
+            flood.inject((const uint8_t *)kFloodLine, line, start + sent * 1000000 / kBtBytesPerS);
+        size_t serial_line = strlen(kSerialLine);
+        for (int i = 0; i < kSerialLines; ++i)
+            uart.inject((const uint8_t *)kSerialLine, serial_line, start + 2000000 + i * serial_line * 1000000 / 11520);
+
+        InputChannel serial_input(uart, echo, uart, "Serial", serial_limits);
+        InputChannel bt_input(flood, echo, flood, "BT", bt_limits);
+        std::vector<std::string> commands;
+        tick_runs_us.clear();
+        Result result = {};
+        while (host::now_us() < start + (uint64_t)kRunSeconds * 1000000)
+        {
+            // the loop() pass: the input first, then the admitted commands
+            uint64_t pass_start = host::now_us();
+            serial_input.poll(commands);
+            bt_input.poll(commands);
+            vTaskDelay(1);
+            for (std::string &command : commands)
+                process_command(command);
+            commands.clear();
+            result.max_pass_us = std::max(result.max_pass_us, host::now_us() - pass_start);
+        }
+
+        for (size_t i = 1; i < tick_runs_us.size(); ++i)
+            result.max_gap_us = std::max(result.max_gap_us, tick_runs_us[i] - tick_runs_us[i - 1]);
+        result.serial_dropped = uart.rx_dropped;
+        const InputChannel::Stats &bt = bt_input.get_stats();
+        const InputChannel::Stats &serial = serial_input.get_stats();
+        std::printf("{\"limits\":\"%s\",\"seconds\":%d,\"scheduled_runs\":%u,\"max_gap_ms\":%.1f,"
+                    "\"max_pass_ms\":%.1f,\"sched_lateness_max_us\":%u,"
+                    "\"bt\":{\"commands\":%u,\"busy\":%u,\"throttled\":%u,\"pending\":%u},"
+                    "\"serial\":{\"commands\":%u,\"busy\":%u,\"throttled\":%u,\"rx_dropped\":%u}}\n",
+                    name, kRunSeconds, (unsigned)tick_runs_us.size(), result.max_gap_us / 1000.0,
+                    result.max_pass_us / 1000.0, (unsigned)schedule_manager.getMaxLatenessUs(),
+                    (unsigned)bt.commands, (unsigned)bt.busy, (unsigned)bt.throttled, (unsigned)flood.pending(),
+                    (unsigned)serial.commands, (unsigned)serial.busy, (unsigned)serial.throttled,
+                    (unsigned)uart.rx_dropped);
+        CHECK(count_of(flood.output, "\"status\":\"busy\"") == bt.busy);
+        CHECK(count_of(uart.output, "\"status\":\"throttled\"") == serial.throttled);
+        return result;
+    }
+}
+
+int main()
+{
+    host::set_wall_clock(kStart);
+    Serial.on_write = [](const uint8_t *, size_t) {}; // the logs of the scheduler
+    command_mutex = xSemaphoreCreateMutex();
+    schedule_manager.addTask("* * * * * *", kTickCommand, 0, OverlapPolicy::SKIP);
+    schedule_manager.startScheduler(process_command);
+
+    InputChannel::Limits open;
+    open.commands_per_s = 60000;
+    open.command_burst = 60000;
+    open.bytes_per_s = 1000000;
+    open.byte_burst = 1000000;
+    open.commands_per_pass = 255;
+    Result unlimited = run("none", open, open);
+    // the loop() holds the command lock pass after pass, the scheduled command waits
+    CHECK(unlimited.max_gap_us > 1000000 + 20 * kCommandCostUs);
+
+    // the firmware: the default limits on BT, no byte budget on Serial
+    Result limited = run("firmware", InputChannel::Limits(), InputChannel::Limits::without_byte_budget());
+    CHECK(limited.max_gap_us <= 1000000 + 3 * kCommandCostUs + 2000);
+    CHECK(limited.max_pass_us <= 2 * 2 * kCommandCostUs + 2000);
+    CHECK_EQ(limited.serial_dropped, 0);
+
+    // a byte budget under the line rate on the UART loses the bytes mid-line
+    Result budgeted = run("serial_byte_budget", InputChannel::Limits(), InputChannel::Limits());
+    CHECK(budgeted.serial_dropped > 0);
+
+    CHECK(schedule_manager.getMaxLatenessUs() <= 1000 * portTICK_PERIOD_MS);
+    host::finish(test_result("InputFloodTest"));
+}
@@ -0,0 +1,171 @@
+/**
+ * @file ScheduleManagerStressTest.cpp
+ * @brief The ScheduleManager writers against its readers on the free running host runtime,
+ * built with ThreadSanitizer.
+ *
+ * The writers add, delete and clear the tasks and restore the crontab through the public calls,
+ * like the commands do, while the readers of the task table run in parallel: the scheduler task
+ * of one manager, the loop() calling checkAndRunTasks() of another one, and the agendas of both.
+ * The managers share the logger, the clock and SPIFFS like on the controller. Any race among them
+ * is reported by ThreadSanitizer, failing the test. Once the writers are done, the restored crontab
+ * shall be listed whole by the agenda.
+ *
+ * The runtime is HostRuntimeThreaded.cpp, a virtual second passes in a host millisecond.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <BluetoothSerial.h>
+#include "ClockHelper.h"
+#include "ScheduleManager.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+BluetoothSerial bt_serial;
+StreamLogger stream_logger(Serial, bt_serial);
+ClockHelper runtime_clock_helper;
+ScheduleManager schedule_manager; // on the scheduler task
+ScheduleManager manual_manager;   // on checkAndRunTasks()
+
+namespace
+{
+    const int kWritersEach = 2;
+    const int kWritesEach = 2000;
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint32_t> executed{0};
+    std::atomic<uint32_t> manualTicks{0};
+    std::atomic<uint32_t> agendaFires{0};
+
+    // 3600 + 60 + 60 + 4 + 1 fires an hour, the second line merges into the first task
+    const char *kCrontab[] = {
+        "0 * * * * * |{\"command\":\"minute\"}",
+        "15 * * * * * |{\"command\":\"minute\"}",
+        "* * * * * * !queue |{\"command\":\"second\"}",
+        "30 0,15,30,45 * * * * !p3 |{\"command\":\"five\"}",
+        "0 0 * * * * |{\"command\":\"hour\"}"};
+    const size_t kCrontabFiresAnHour = 3600 + 60 + 60 + 4 + 1;
+
+    bool command(std::string &config)
+    {
+        executed.fetch_add(1);
+        return !config.empty();
+    }
+
+    std::time_t local_now()
+    {
+        return runtime_clock_helper.utc_to_local(std::time(nullptr));
+    }
+
+    void writer(ScheduleManager &manager, int seed)
+    {
+        uint32_t random = seed * 2654435761u + 1;
+        for (int i = 0; i < kWritesEach; ++i)
+        {
+            random = random * 1103515245u + 12345u;
+            char schedule[32], config[64];
+            switch (random >> 28)
+            {
+            case 0:
+                manager.restoreFromSpiffs();
+                break;
+            case 1:
+                manager.deleteAllTasks();
+                break;
+            case 2:
+            case 3:
+            case 4:
+            case 5:
+                manager.deleteTask((random >> 8) % 8);
+                break;
+            default:
+                snprintf(schedule, sizeof(schedule), "%u,%u * * * * *%s", (random >> 8) % 30, 30 + (random >> 16) % 30,
+                         (random & 0x100) ? " !concurrent" : "");
+                snprintf(config, sizeof(config), "{\"command\":\"w%d\",\"n\":%u}", seed, (random >> 12) % 4);
+                manager.addTask(schedule, config);
+                break;
+            }
+        }
+    }
+
+    void manual_loop()
+    {
+        while (!stop.load())
+        {
+            manual_manager.checkAndRunTasks(command);
+            manualTicks.fetch_add(1);
+            vTaskDelay(1);
+        }
+    }
+
+    void agenda_reader(ScheduleManager &manager)
+    {
+        while (!stop.load())
+        {
+            std::time_t from = local_now();
+            agendaFires.fetch_add(manager.agenda(from, from + 60, "",
+                                                 [](std::time_t, int, const ScheduledTask &)
+                                                 { return true; }));
+        }
+    }
+}
+
+int main()
+{
+    Serial.on_write = [](const uint8_t *, size_t) {}; // the crontab listings of the restores
+    host::set_wall_clock(1760000000);
+    File file = SPIFFS.open("/crontab", FILE_WRITE);
+    for (const char *line : kCrontab)
+        file.println(line);
+    file.close();
+
+    CHECK(schedule_manager.startScheduler(command));
+    manual_manager.checkAndRunTasks(command); // starts the workers
+
+    std::vector<std::thread> readers;
+    readers.emplace_back(manual_loop);
+    readers.emplace_back(agenda_reader, std::ref(schedule_manager));
+    readers.emplace_back(agenda_reader, std::ref(manual_manager));
+    std::vector<std::thread> writers;
+    for (int i = 0; i < kWritersEach; ++i)
+    {
+        writers.emplace_back(writer, std::ref(schedule_manager), 2 * i + 1);
+        writers.emplace_back(writer, std::ref(manual_manager), 2 * i + 2);
+    }
+    for (std::thread &t : writers)
+        t.join();
+
+    // the last snapshot is the crontab, whole, the readers keep going meanwhile
+    for (ScheduleManager *manager : {&schedule_manager, &manual_manager})
+    {
+        manager->restoreFromSpiffs();
+        std::time_t hour = local_now() / 3600 * 3600 + 3600;
+        size_t fires = manager->agenda(hour, hour + 3599, "",
+                                       [](std::time_t, int, const ScheduledTask &)
+                                       { return true; });
+        CHECK_EQ(fires, kCrontabFiresAnHour);
+    }
+    stop.store(true);
+    for (std::thread &t : readers)
+        t.join();
+
+    CommandDispatcher::Stats scheduled = schedule_manager.getDispatchStats();
+    CommandDispatcher::Stats manual = manual_manager.getDispatchStats();
+    std::printf("scheduler: %u submitted, manual: %u ticks %u submitted, agenda: %u fires, %u executed\n",
+                (unsigned)scheduled.submitted, (unsigned)manualTicks.load(), (unsigned)manual.submitted,
+                (unsigned)agendaFires.load(), (unsigned)executed.load());
+    CHECK(scheduled.submitted > 0);
+    CHECK(manual.submitted > 0);
+    CHECK(agendaFires.load() > 0);
+    CHECK(executed.load() > 0);
+    // the scheduler task and the workers never end, no unwinding under them
+    host::finish(test_result("ScheduleManagerStressTest"));
+}
@@ -0,0 +1,295 @@
+/**
+ * @file ScheduleManagerTest.cpp
+ * @brief The ScheduleManager ticks with the CommandDispatcher workers on the simulated kernel.
+ *
+ * The ticks are driven by checkAndRunTasks() at the chosen virtual seconds, the worker
+ * executes the commands with the given duration. The dispatcher is also tested on its own:
+ * the priority order, the overlap policies and the back-pressure of a full queue. A clock step
+ * replays the skipped fires in the time order, the scheduler task dispatches on the second boundary.
+ * The crontab restored from SPIFFS merges the lines sending the same command with the same options.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include <BluetoothSerial.h>
+#include "ClockHelper.h"
+#include "CommandDispatcher.h"
+#include "ScheduleManager.h"
+
+#include <vector>
+
+BluetoothSerial bt_serial;
+StreamLogger stream_logger(Serial, bt_serial);
+ClockHelper runtime_clock_helper;
+ScheduleManager schedule_manager;
+
+namespace
+{
+    const std::time_t kStart = 1760000000;
+    const char *kCommand = "{\"command\":\"path_player_switch\",\"player\":\"on\"}";
+
+    int executed = 0;
+    std::vector<std::string> dispatched; // the configs in the order the worker ran them
+
+    // Holds the worker for 100 ms
+    bool recording_command(std::string &config)
+    {
+        dispatched.push_back(config);
+        vTaskDelay(100);
+        return true;
+    }
+
+    // The worker runs forever, the dispatcher must outlive it
+    CommandDispatcher *start_dispatcher(size_t capacity)
+    {
+        CommandDispatcher *dispatcher = new CommandDispatcher(capacity);
+        dispatcher->begin(recording_command);
+        dispatched.clear();
+        return dispatcher;
+    }
+
+    std::shared_ptr<ScheduledTask> make_task(const char *config, uint8_t priority, OverlapPolicy policy)
+    {
+        return std::make_shared<ScheduledTask>("* * * * * *", config, priority, policy);
+    }
+
+    // Holds the worker for 2.5 s, the task stays in flight over the next ticks
+    bool slow_command(std::string &config)
+    {
+        (void)config;
+        executed++;
+        vTaskDelay(2500);
+        return true;
+    }
+
+    // A fire dropped by its own task (SKIP in flight) does not make the same command
+    // of another task a duplicate, that one still goes out in the tick
+    void test_duplicate_after_dropped_fire()
+    {
+        schedule_manager.addTask("* * * * * *", kCommand, 0, OverlapPolicy::SKIP);
+        schedule_manager.addTask("* * * * * *", kCommand, 0, OverlapPolicy::QUEUE);
+
+        schedule_manager.checkAndRunTasks(slow_command);
+        CommandDispatcher::Stats stats = schedule_manager.getDispatchStats();
+        CHECK_EQ(stats.submitted, 1); // the second task is the duplicate
+        CHECK_EQ(stats.skippedOverlap, 0);
+
+        vTaskDelay(1000); // the worker starts the command
+        CHECK_EQ(executed, 1);
+        schedule_manager.checkAndRunTasks(slow_command);
+        stats = schedule_manager.getDispatchStats();
+        CHECK_EQ(stats.skippedOverlap, 1); // the first task is still running
+        CHECK_EQ(stats.submitted, 2);      // so the second one sends the command
+
+        Serial.output.clear();
+        schedule_manager.printSchedulerStats();
+        stream_logger.flush();
+        CHECK(Serial.output.find("1 duplicate dispatches saved") != std::string::npos);
+    }
+
+    // The queued fires run by priority, FIFO among the equal ones
+    void test_priority_order()
+    {
+        CommandDispatcher *dispatcher = start_dispatcher(8);
+        // the worker has the priority of this task, it starts once this one blocks
+        CHECK(dispatcher->submit(make_task("low", 0, OverlapPolicy::CONCURRENT)));
+        CHECK(dispatcher->submit(make_task("mid", 1, OverlapPolicy::CONCURRENT)));
+        CHECK(dispatcher->submit(make_task("high", 5, OverlapPolicy::CONCURRENT)));
+        CHECK(dispatcher->submit(make_task("high too", 5, OverlapPolicy::CONCURRENT)));
+        vTaskDelay(1000);
+        CHECK(dispatched == std::vector<std::string>({"high", "high too", "mid", "low"}));
+        CHECK_EQ(dispatcher->getStats().completed, 4);
+    }
+
+    // Three fires while the first run executes: SKIP drops them, QUEUE folds them into one run
+    // behind the running one, CONCURRENT runs every one of them
+    void test_overlap_policies()
+    {
+        const OverlapPolicy policies[] = {OverlapPolicy::SKIP, OverlapPolicy::QUEUE, OverlapPolicy::CONCURRENT};
+        const int runs[] = {1, 2, 4};
+        for (int i = 0; i < 3; ++i)
+        {
+            CommandDispatcher *dispatcher = start_dispatcher(8);
+            std::shared_ptr<ScheduledTask> task = make_task("slow", 0, policies[i]);
+            CHECK(dispatcher->submit(task));
+            vTaskDelay(1); // the worker starts the run
+            CHECK(task->running.load());
+            int accepted = 0;
+            for (int fire = 0; fire < 3; ++fire)
+                accepted += dispatcher->submit(task);
+            vTaskDelay(1000);
+            CommandDispatcher::Stats stats = dispatcher->getStats();
+            CHECK_EQ(dispatched.size(), runs[i]);
+            CHECK_EQ(stats.completed, runs[i]);
+            CHECK_EQ(task->inFlight.load(), 0);
+            if (policies[i] == OverlapPolicy::SKIP)
+            {
+                CHECK_EQ(accepted, 0);
+                CHECK_EQ(stats.skippedOverlap, 3);
+            }
+            else if (policies[i] == OverlapPolicy::QUEUE)
+            {
+                CHECK_EQ(accepted, 3); // the folded fires are served by the queued run
+                CHECK_EQ(stats.submitted, 2);
+                CHECK_EQ(stats.deferred, 2);
+            }
+            else
+            {
+                CHECK_EQ(stats.submitted, 4);
+                CHECK_EQ(stats.deferred, 0);
+            }
+        }
+    }
+
+    // A full queue drops the fire and counts it, the submit never waits for the worker
+    void test_full_queue()
+    {
+        CommandDispatcher *dispatcher = start_dispatcher(2);
+        std::shared_ptr<ScheduledTask> task = make_task("burst", 0, OverlapPolicy::CONCURRENT);
+        uint64_t start = host::now_us();
+        int accepted = 0;
+        for (int fire = 0; fire < 5; ++fire)
+            accepted += dispatcher->submit(task);
+        CHECK_EQ(host::now_us(), start);
+        CHECK_EQ(accepted, 2);
+        CommandDispatcher::Stats stats = dispatcher->getStats();
+        CHECK_EQ(stats.droppedFull, 3);
+        CHECK_EQ(stats.highWatermark, 2);
+        vTaskDelay(1000);
+        CHECK_EQ(dispatcher->getStats().completed, 2);
+        CHECK_EQ(task->inFlight.load(), 0);
+    }
+}
+
+namespace
+{
+    // The skipped fires go out in the time order, the last fire of a command wins
+    void test_clock_step()
+    {
+        const std::time_t ten = (kStart / 86400 + 1) * 86400 + 10 * 3600; // 10:00 UTC, the zone is UTC
+        ScheduleManager *manager = new ScheduleManager(); // the worker runs forever
+        manager->addTask("0 30 10 * * *", "{\"command\":\"path_player_switch\",\"player\":\"off\"}");
+        manager->addTask("0 0 10 * * *", "{\"command\":\"path_player_switch\",\"player\":\"on\"}");
+        manager->addTask("0 40 10 * * *", "{\"command\":\"laser\",\"power\":0}");
+        manager->addTask("0 15 10 * * *", "{\"command\":\"laser\",\"power\":1}");
+        manager->addTask("0 20 10 * * *", "{\"command\":\"get_agenda\"}");
+        manager->addTask("0 5 10 * * *", "{\"command\":\"list_tasks\"}");
+        manager->addTask("0 50 10 * * *", "{\"command\":\"list_tasks\",\"late\":1}"); // after the step
+
+        dispatched.clear();
+        host::set_wall_clock(ten - 1);
+        manager->checkAndRunTasks(recording_command);
+        host::set_wall_clock(ten + 45 * 60); // the sync steps the clock 45 minutes ahead
+        manager->checkAndRunTasks(recording_command);
+        vTaskDelay(1000);
+        CHECK(dispatched == std::vector<std::string>({
+                                "{\"command\":\"list_tasks\"}",
+                                "{\"command\":\"get_agenda\"}",
+                                "{\"command\":\"path_player_switch\",\"player\":\"off\"}",
+                                "{\"command\":\"laser\",\"power\":0}",
+                            }));
+
+        Serial.output.clear();
+        manager->printSchedulerStats();
+        stream_logger.flush();
+        CHECK(Serial.output.find("2 catch-up fires superseded") != std::string::npos);
+    }
+
+    // The duplicate crontab lines: the same config and options merge into one task, a different
+    // priority or policy keeps its own task, an identical line adds nothing
+    void test_restore_merges_duplicates()
+    {
+        const std::string on = "{\"command\":\"path_player_switch\",\"player\":\"on\"}";
+        const std::string laser = "{\"command\":\"laser\",\"power\":1}";
+        File file = SPIFFS.open("/crontab", FILE_WRITE);
+        file.println(("0 7 * * * |" + on).c_str());
+        file.println(("30 7 * * * |" + on).c_str());       // merged into the first
+        file.println(("0 8 * * * !p3 |" + on).c_str());    // another priority, its own task
+        file.println(("0 9 * * * !queue |" + on).c_str()); // another policy, its own task
+        file.println(("0 7 * * * |" + laser).c_str());     // another config
+        file.println(("0 7 * * * !p3 |" + on).c_str());    // merged into the !p3 one
+        file.println(("0 7 * * * |" + on).c_str());        // the same line again
+        file.close();
+
+        ScheduleManager *manager = new ScheduleManager(); // the worker runs forever
+        manager->restoreFromSpiffs();
+        Serial.output.clear();
+        manager->printSchedulerStats();
+        stream_logger.flush();
+        CHECK(Serial.output.find("3 crontab lines merged") != std::string::npos);
+
+        // saved back one line per rule, in the order of the tasks
+        manager->saveToSpiffs();
+        CHECK(SPIFFS.content_of("/crontab") ==
+              "0 7 * * * |" + on + "\r\n" +
+                  "30 7 * * * |" + on + "\r\n" +
+                  "0 8 * * * !p3 |" + on + "\r\n" +
+                  "0 7 * * * !p3 |" + on + "\r\n" +
+                  "0 9 * * * !queue |" + on + "\r\n" +
+                  "0 7 * * * |" + laser + "\r\n");
+
+        // 07:00 the plain and the !p3 task fire with the same config, it goes out once
+        const std::time_t day = (kStart / 86400 + 2) * 86400;
+        const int hours[] = {7 * 3600, 7 * 3600 + 1800, 8 * 3600, 9 * 3600};
+        dispatched.clear();
+        for (int at : hours)
+        {
+            host::set_wall_clock(day + at - 1);
+            manager->checkAndRunTasks(recording_command);
+            host::set_wall_clock(day + at);
+            manager->checkAndRunTasks(recording_command);
+            vTaskDelay(1000);
+        }
+        CHECK(dispatched == std::vector<std::string>({on, laser, on, on, on}));
+        CHECK_EQ(manager->getDedupedDispatches(), 1);
+        CHECK_EQ(manager->getDispatchStats().completed, 5);
+    }
+
+    std::vector<struct timeval> boundary_runs;
+
+    bool boundary_command(std::string &config)
+    {
+        (void)config;
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        boundary_runs.push_back(now);
+        return true;
+    }
+
+    // The scheduler task wakes on the second boundary, every second is dispatched once
+    void test_second_boundary()
+    {
+        host::set_wall_clock(kStart);
+        vTaskDelay(333); // off the boundary
+        ScheduleManager *manager = new ScheduleManager(); // the tasks run forever
+        manager->addTask("* * * * * *", kCommand);
+        CHECK(manager->startScheduler(boundary_command));
+        vTaskDelay(5000);
+        CHECK(boundary_runs.size() >= 4);
+        for (size_t i = 0; i < boundary_runs.size(); ++i)
+        {
+            CHECK(boundary_runs[i].tv_usec < 2000);
+            if (i > 0)
+                CHECK_EQ(boundary_runs[i].tv_sec, boundary_runs[i - 1].tv_sec + 1);
+        }
+        CHECK(manager->getMaxLatenessUs() < 2000);
+    }
+}
+
+int main()
+{
+    host::set_wall_clock(kStart);
+    test_duplicate_after_dropped_fire();
+    test_priority_order();
+    test_overlap_policies();
+    test_full_queue();
+    test_clock_step();
+    test_restore_merges_duplicates();
+    test_second_boundary();
+    host::finish(test_result("ScheduleManagerTest"));
+}
@@ -0,0 +1,144 @@
+/**
+ * @file TaskTableStressTest.cpp
+ * @brief TaskTable under the concurrent readers and mutators, built with ThreadSanitizer.
+ *
+ * Every reader slot spins on its ReadGuard and walk every snapshot they get, while several
+ * mutators add, remove and replace the tasks under a writer lock, like the ScheduleManager
+ * commands do. A snapshot reclaimed while a reader still holds it is a data race (the delete
+ * against the reads) that ThreadSanitizer reports, failing the test. Every snapshot is
+ * also checked to be whole: the task ids ascending, the count matching the checksum task.
+ *
+ * The tasks are a stand-in of ScheduledTask, the table never looks inside them, see
+ * ScheduleManagerStressTest.cpp for the real tasks and writers.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include "TaskTable.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ScheduledTask
+{
+public:
+    explicit ScheduledTask(int id) : id(id) {}
+    const int id;
+    std::atomic<uint32_t> fired{0}; // the run state shared by the snapshots
+};
+
+namespace
+{
+    const int kMutators = 3;
+    const int kMutationsEach = 3000;
+
+    TaskTable table;
+    std::mutex writerLock;
+    std::atomic<bool> stop{false};
+    std::atomic<int> brokenSnapshots{0};
+
+    // The first task holds the number of the tasks after it, the rest have ascending ids
+    TaskList *make_list(const std::vector<int> &ids)
+    {
+        TaskList *list = new TaskList();
+        list->push_back(std::make_shared<ScheduledTask>((int)ids.size()));
+        for (int id : ids)
+            list->push_back(std::make_shared<ScheduledTask>(id));
+        return list;
+    }
+
+    void reader(TaskTable::ReaderSlot slot, uint64_t &walked)
+    {
+        while (!stop.load())
+        {
+            TaskTable::ReadGuard tasks(table, slot);
+            bool whole = !tasks->empty() && (size_t)tasks->front()->id == tasks->size() - 1;
+            for (size_t i = 1; i < tasks->size(); ++i)
+            {
+                (*tasks)[i]->fired.fetch_add(1);
+                if (i > 1 && (*tasks)[i]->id <= (*tasks)[i - 1]->id)
+                    whole = false;
+            }
+            if (!whole)
+                brokenSnapshots.fetch_add(1);
+            walked++;
+        }
+    }
+
+    void mutator(int seed)
+    {
+        uint32_t random = seed * 2654435761u + 1;
+        for (int i = 0; i < kMutationsEach; ++i)
+        {
+            random = random * 1103515245u + 12345u;
+            std::lock_guard<std::mutex> guard(writerLock);
+            const TaskList &current = table.snapshot();
+            // copy the tasks (shared, not cloned), change the copy
+            TaskList *next = new TaskList(current);
+            int lastId = next->size() > 1 ? next->back()->id : 0;
+            switch (random >> 29)
+            {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+                next->push_back(std::make_shared<ScheduledTask>(lastId + 1));
+                break;
+            case 4:
+            case 5:
+                if (next->size() > 1)
+                    next->erase(next->begin() + 1 + (random >> 8) % (next->size() - 1));
+                break;
+            case 6:
+                if (next->size() > 1) // a task replaced by a new one with the same place in the order
+                {
+                    size_t index = 1 + (random >> 8) % (next->size() - 1);
+                    (*next)[index] = std::make_shared<ScheduledTask>((*next)[index]->id);
+                }
+                break;
+            default:
+                next->resize(1); // clear
+                break;
+            }
+            (*next)[0] = std::make_shared<ScheduledTask>((int)next->size() - 1);
+            table.publish(next);
+        }
+    }
+}
+
+int main()
+{
+    table.publish(make_list({1, 2, 3}));
+
+    uint64_t walked[TaskTable::READER_SLOTS] = {};
+    std::vector<std::thread> threads;
+    for (int slot = 0; slot < TaskTable::READER_SLOTS; ++slot)
+        threads.emplace_back(reader, (TaskTable::ReaderSlot)slot, std::ref(walked[slot]));
+    std::vector<std::thread> mutators;
+    for (int i = 0; i < kMutators; ++i)
+        mutators.emplace_back(mutator, i + 1);
+    for (std::thread &t : mutators)
+        t.join();
+    stop.store(true);
+    for (std::thread &t : threads)
+        t.join();
+
+    for (int slot = 0; slot < TaskTable::READER_SLOTS; ++slot)
+    {
+        std::printf("reader %d walked %llu snapshots\n", slot, (unsigned long long)walked[slot]);
+        CHECK(walked[slot] > 0);
+    }
+    CHECK_EQ(brokenSnapshots.load(), 0);
+
+    // the readers are gone, the next publish reclaims every retired snapshot
+    table.publish(make_list({}));
+    CHECK_EQ(table.retiredCount(), 0);
+    return test_result("TaskTableStressTest");
+}
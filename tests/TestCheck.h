@@ -0,0 +1,42 @@
+/**
+ * @file TestCheck.h
+ * @brief The checks of the host tests, a failed check is printed and counted, the test goes on.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <cstdio>
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                                 \
+    do                                                                              \
+    {                                                                               \
+        if (!(cond))                                                                \
+        {                                                                           \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);    \
+            ++test_failures;                                                        \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                  \
+    do                                                                              \
+    {                                                                               \
+        long long a_ = (long long)(actual), e_ = (long long)(expected);             \
+        if (a_ != e_)                                                               \
+        {                                                                           \
+            std::printf("%s:%d: CHECK_EQ(%s, %s) failed, %lld != %lld\n", __FILE__, \
+                        __LINE__, #actual, #expected, a_, e_);                      \
+            ++test_failures;                                                        \
+        }                                                                           \
+    } while (0)
+
+// The exit code of the test, 0 if every check passed
+inline int test_result(const char *name)
+{
+    std::printf("%s: %s, %d failed checks\n", name, test_failures ? "FAILED" : "passed", test_failures);
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,308 @@
+/**
+ * @file TimeZoneRulesTest.cpp
+ * @brief The POSIX TZ rules, the DST conversions and the wall clock sequence of the scheduler.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "TestCheck.h"
+
+#include "TimeZoneRules.h"
+#include "WallClockSequence.h"
+
+#include <vector>
+
+namespace
+{
+    // Seconds since the epoch of the date and time, UTC or the local wall clock alike
+    std::time_t at(int year, int month, int day, int hour = 0, int minute = 0, int second = 0)
+    {
+        return TimeZoneRules::days_from_civil(year, month, day) * TimeZoneRules::seconds_per_day +
+               hour * 3600 + minute * 60 + second;
+    }
+
+    bool has_transition(const TimeZoneRules &rules, std::time_t utc, int32_t offset)
+    {
+        for (const TzTransition &tr : rules.get_transitions())
+            if (tr.utc == utc && tr.offset == offset)
+                return true;
+        return false;
+    }
+
+    void test_days_from_civil()
+    {
+        CHECK_EQ(TimeZoneRules::days_from_civil(1970, 1, 1), 0);
+        CHECK_EQ(TimeZoneRules::days_from_civil(2000, 3, 1), 11017);
+        CHECK_EQ(TimeZoneRules::days_from_civil(2024, 2, 29) + 1, TimeZoneRules::days_from_civil(2024, 3, 1));
+        CHECK_EQ(at(2024, 10, 19, 12, 0, 0), 1729339200);
+    }
+
+    // US Eastern, 2024: forward on March 10 02:00 EST, back on November 3 02:00 EDT
+    void test_spring_forward()
+    {
+        TimeZoneRules rules;
+        CHECK(rules.build("EST5EDT,M3.2.0,M11.1.0", 2023));
+        CHECK_EQ(rules.get_transitions().size(), 2 * TimeZoneRules::table_years);
+        const std::time_t switch_utc = at(2024, 3, 10, 7);
+        CHECK(has_transition(rules, switch_utc, -4 * 3600));
+
+        CHECK_EQ(rules.utc_to_local(switch_utc - 1), at(2024, 3, 10, 1, 59, 59));
+        CHECK_EQ(rules.utc_to_local(switch_utc), at(2024, 3, 10, 3));
+        CHECK_EQ(rules.local_to_utc(at(2024, 3, 10, 1, 59, 59)), switch_utc - 1);
+        CHECK_EQ(rules.local_to_utc(at(2024, 3, 10, 3)), switch_utc);
+        // 02:30 does not exist, it resolves to the first second after the gap
+        CHECK_EQ(rules.local_to_utc(at(2024, 3, 10, 2, 30)), switch_utc);
+        CHECK_EQ(rules.local_to_utc(at(2024, 3, 10, 2)), switch_utc);
+    }
+
+    void test_fall_back()
+    {
+        TimeZoneRules rules;
+        CHECK(rules.build("EST5EDT,M3.2.0,M11.1.0", 2023));
+        const std::time_t switch_utc = at(2024, 11, 3, 6);
+        CHECK(has_transition(rules, switch_utc, -5 * 3600));
+
+        CHECK_EQ(rules.utc_to_local(switch_utc - 1), at(2024, 11, 3, 1, 59, 59));
+        CHECK_EQ(rules.utc_to_local(switch_utc), at(2024, 11, 3, 1));
+        // 01:30 happens twice, it resolves to the first occurrence (EDT)
+        CHECK_EQ(rules.local_to_utc(at(2024, 11, 3, 1, 30)), at(2024, 11, 3, 5, 30));
+        CHECK_EQ(rules.local_to_utc(at(2024, 11, 3, 2)), at(2024, 11, 3, 7));
+        // near the current clock it resolves to the occurrence the clock is in
+        CHECK_EQ(rules.local_to_utc(at(2024, 11, 3, 1, 30), at(2024, 11, 3, 5, 50)), at(2024, 11, 3, 5, 30));
+        CHECK_EQ(rules.local_to_utc(at(2024, 11, 3, 1, 30), at(2024, 11, 3, 6, 20)), at(2024, 11, 3, 6, 30));
+        CHECK_EQ(rules.local_to_utc(at(2024, 11, 3, 3), at(2024, 11, 3, 6, 20)), at(2024, 11, 3, 8));
+        CHECK_EQ(rules.local_to_utc(at(2024, 3, 10, 2, 30), at(2024, 3, 10, 7)), at(2024, 3, 10, 7));
+        CHECK_EQ(rules.utc_to_local(at(2024, 7, 1, 12)), at(2024, 7, 1, 8));
+        CHECK_EQ(rules.utc_to_local(at(2024, 12, 1, 12)), at(2024, 12, 1, 7));
+    }
+
+    // Central Europe, the last Sunday with the explicit switch time, "/3"
+    void test_explicit_time()
+    {
+        TimeZoneRules rules;
+        CHECK(rules.build("CET-1CEST,M3.5.0,M10.5.0/3", 2023));
+        CHECK(has_transition(rules, at(2024, 3, 31, 1), 2 * 3600));
+        CHECK(has_transition(rules, at(2024, 10, 27, 1), 3600));
+        CHECK(has_transition(rules, at(2025, 3, 30, 1), 2 * 3600));
+        CHECK(has_transition(rules, at(2025, 10, 26, 1), 3600));
+    }
+
+    // Sydney, the DST is in force over the new year
+    void test_southern_hemisphere()
+    {
+        TimeZoneRules rules;
+        CHECK(rules.build("AEST-10AEDT,M10.1.0,M4.1.0/3", 2023));
+        // the year starts in the DST
+        CHECK_EQ(rules.utc_to_local(at(2023, 1, 15, 0)), at(2023, 1, 15, 11));
+        // back on April 7 03:00 AEDT, forward on October 6 02:00 AEST
+        CHECK(has_transition(rules, at(2024, 4, 6, 16), 10 * 3600));
+        CHECK(has_transition(rules, at(2024, 10, 5, 16), 11 * 3600));
+        CHECK_EQ(rules.utc_to_local(at(2024, 6, 1, 0)), at(2024, 6, 1, 10));
+        CHECK_EQ(rules.utc_to_local(at(2024, 12, 1, 0)), at(2024, 12, 1, 11));
+        CHECK_EQ(rules.local_to_utc(at(2024, 10, 6, 2, 30)), at(2024, 10, 5, 16));
+        CHECK_EQ(rules.local_to_utc(at(2024, 4, 7, 2, 30)), at(2024, 4, 6, 15, 30));
+    }
+
+    // "Jn" never counts February 29, "n" is zero based and counts it
+    void test_julian_rules()
+    {
+        TimeZoneRules julian;
+        CHECK(julian.build("AAA0BBB,J60,J300", 2023));
+        CHECK(has_transition(julian, at(2023, 3, 1, 2), 3600));
+        CHECK(has_transition(julian, at(2024, 3, 1, 2), 3600));
+        CHECK(has_transition(julian, at(2023, 10, 27, 1), 0));
+        CHECK(has_transition(julian, at(2024, 10, 27, 1), 0));
+
+        TimeZoneRules zero_based;
+        CHECK(zero_based.build("AAA0BBB,59/0,299/0", 2023));
+        CHECK(has_transition(zero_based, at(2023, 3, 1, 0), 3600));
+        CHECK(has_transition(zero_based, at(2024, 2, 29, 0), 3600));
+        CHECK(has_transition(zero_based, at(2023, 10, 27, 0) - 3600, 0));
+        CHECK(has_transition(zero_based, at(2024, 10, 26, 0) - 3600, 0));
+    }
+
+    void test_parser()
+    {
+        TimeZoneRules rules;
+        CHECK(rules.build("UTC0", 2023));
+        CHECK(rules.get_transitions().empty());
+        CHECK_EQ(rules.utc_to_local(at(2024, 7, 1)), at(2024, 7, 1));
+
+        CHECK(rules.build("<+0330>-3:30", 2023));
+        CHECK_EQ(rules.utc_to_local(at(2024, 7, 1)), at(2024, 7, 1, 3, 30));
+
+        // the DST name without the rules switches by the US rules, the explicit DST offset applies
+        CHECK(rules.build("EST5EDT", 2023));
+        CHECK(has_transition(rules, at(2024, 3, 10, 7), -4 * 3600));
+        CHECK(rules.build("AAA3BBB1:30,M3.2.0,M11.1.0", 2023));
+        CHECK_EQ(rules.utc_to_local(at(2024, 7, 1, 12)), at(2024, 7, 1, 10, 30));
+
+        const char *malformed[] = {"", "E5", "EST", "EST5EDT,M13.1.0,M11.1.0", "EST5EDT,M3.2.0",
+                                   "EST5EDT,M3.6.0,M11.1.0", "EST5EDT,J0,J300", "EST5EDT,366,300",
+                                   "EST5EDT,M3.2.0,M11.1.0x", "<+03-3"};
+        for (const char *tz : malformed)
+        {
+            CHECK(!rules.build(tz, 2023));
+            CHECK(rules.get_posix_tz() == "AAA3BBB1:30,M3.2.0,M11.1.0"); // intact
+        }
+    }
+
+    void test_coverage()
+    {
+        TimeZoneRules rules;
+        CHECK(rules.build("EST5EDT,M3.2.0,M11.1.0", 2023));
+        CHECK(!rules.covers(2023));
+        CHECK(rules.covers(2024));
+        CHECK(rules.covers(2029));
+        CHECK(!rules.covers(2030));
+        // the RTC read back as 2124 used to rebuild the table far from the system clock
+        CHECK(!rules.covers(2124));
+    }
+
+    /**
+     * Feeds the UTC seconds through the sequence and counts how many times every local
+     * second of [local_from, local_to] is served, as the scheduler does.
+     */
+    struct Served
+    {
+        std::time_t local_from;
+        std::vector<int> count;
+
+        Served(std::time_t local_from, std::time_t local_to)
+            : local_from(local_from), count(local_to - local_from + 1, 0) {}
+
+        void serve(std::time_t local)
+        {
+            if (local >= local_from && local < local_from + (std::time_t)count.size())
+                count[local - local_from]++;
+        }
+
+        void tick(WallClockSequence &sequence, const TimeZoneRules &rules, std::time_t utc)
+        {
+            std::time_t local = rules.utc_to_local(utc), gap_from;
+            if (!sequence.advance(utc, local, gap_from))
+                return;
+            for (std::time_t t = gap_from; gap_from != 0 && t < local; ++t)
+                serve(t);
+            serve(local);
+        }
+
+        int times_served(std::time_t local) const { return count[local - local_from]; }
+
+        bool each_once() const
+        {
+            for (int c : count)
+                if (c != 1)
+                    return false;
+            return true;
+        }
+    };
+
+    void test_sequence_dst()
+    {
+        TimeZoneRules rules;
+        CHECK(rules.build("EST5EDT,M3.2.0,M11.1.0", 2023));
+
+        // spring forward, 02:00-02:59:59 is skipped on the wall clock, served at 03:00:00
+        {
+            WallClockSequence sequence;
+            Served served(at(2024, 3, 10, 1), at(2024, 3, 10, 4));
+            for (std::time_t utc = at(2024, 3, 10, 6); utc <= at(2024, 3, 10, 8); ++utc)
+                served.tick(sequence, rules, utc);
+            CHECK(served.each_once());
+        }
+        // fall back, 01:00-01:59:59 comes twice, served once
+        {
+            WallClockSequence sequence;
+            Served served(at(2024, 11, 3, 0), at(2024, 11, 3, 2));
+            for (std::time_t utc = at(2024, 11, 3, 4); utc <= at(2024, 11, 3, 7); ++utc)
+                served.tick(sequence, rules, utc);
+            CHECK(served.each_once());
+        }
+
+        TimeZoneRules sydney;
+        CHECK(sydney.build("AEST-10AEDT,M10.1.0,M4.1.0/3", 2023));
+        {
+            WallClockSequence sequence;
+            Served served(at(2024, 4, 7, 1), at(2024, 4, 7, 4));
+            for (std::time_t utc = at(2024, 4, 6, 14); utc <= at(2024, 4, 6, 18); ++utc)
+                served.tick(sequence, sydney, utc);
+            CHECK(served.each_once());
+        }
+        {
+            WallClockSequence sequence;
+            Served served(at(2024, 10, 6, 1), at(2024, 10, 6, 4));
+            for (std::time_t utc = at(2024, 10, 5, 14); utc <= at(2024, 10, 5, 18); ++utc)
+                served.tick(sequence, sydney, utc);
+            CHECK(served.each_once());
+        }
+    }
+
+    void test_sequence_steps()
+    {
+        TimeZoneRules utc_rules;
+        CHECK(utc_rules.build("UTC0", 2023));
+        const std::time_t start = at(2024, 6, 1, 12);
+
+        // stepped ahead by 10 minutes, the :00 in the gap is served at the first second after the step
+        {
+            WallClockSequence sequence;
+            Served served(start, start + 1800);
+            for (std::time_t utc = start; utc < start + 300; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            for (std::time_t utc = start + 900; utc <= start + 1800; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            CHECK(served.each_once());
+        }
+        // stepped back by 5 minutes, nothing served twice
+        {
+            WallClockSequence sequence;
+            Served served(start, start + 1800);
+            for (std::time_t utc = start; utc < start + 900; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            for (std::time_t utc = start + 600; utc <= start + 1800; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            CHECK(served.each_once());
+        }
+        // stepped ahead by 2 hours, only the last hour is caught up
+        {
+            WallClockSequence sequence(3600);
+            Served served(start, start + 3 * 3600);
+            for (std::time_t utc = start; utc < start + 600; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            for (std::time_t utc = start + 600 + 7200; utc <= start + 3 * 3600; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            CHECK_EQ(served.times_served(start + 600 + 3599), 0);
+            CHECK_EQ(served.times_served(start + 600 + 3600), 1);
+            CHECK_EQ(served.times_served(start + 3 * 3600), 1);
+        }
+        // stepped back by a day, the sequence restarts instead of stalling for a day
+        {
+            WallClockSequence sequence;
+            Served served(start - 86400, start + 600);
+            for (std::time_t utc = start; utc <= start + 600; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            for (std::time_t utc = start - 86400; utc <= start - 86400 + 600; ++utc)
+                served.tick(sequence, utc_rules, utc);
+            CHECK_EQ(served.times_served(start - 86400), 1);
+            CHECK_EQ(served.times_served(start - 86400 + 600), 1);
+        }
+    }
+}
+
+int main()
+{
+    test_days_from_civil();
+    test_spring_forward();
+    test_fall_back();
+    test_explicit_time();
+    test_southern_hemisphere();
+    test_julian_rules();
+    test_parser();
+    test_coverage();
+    test_sequence_dst();
+    test_sequence_steps();
+    return test_result("TimeZoneRulesTest");
+}
@@ -0,0 +1,10 @@
+/**
+ * @file AlgoHelper.h
+ * @brief The host stand-in of AlgoHelper.h, ScheduleManager.h includes it, nothing it holds is used on the host.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
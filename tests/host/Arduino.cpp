@@ -0,0 +1,178 @@
+/**
+ * @file Arduino.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "Arduino.h"
+
+#include <algorithm>
+#include <cctype>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+void String::trim()
+{
+    size_t begin = 0, end = text.size();
+    while (begin < end && isspace((unsigned char)text[begin]))
+        ++begin;
+    while (end > begin && isspace((unsigned char)text[end - 1]))
+        --end;
+    text = text.substr(begin, end - begin);
+}
+
+size_t Print::write(const uint8_t *data, size_t size)
+{
+    size_t written = 0;
+    while (size--)
+        written += write(*data++);
+    return written;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0)
+        return 0;
+    if ((size_t)length < sizeof(buffer))
+        return write((const uint8_t *)buffer, length);
+
+    std::string large(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&large[0], large.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)large.data(), length);
+}
+
+size_t Print::print(long value, int base)
+{
+    if (value < 0 && base == DEC)
+        return print('-') + print((unsigned long)-value, base);
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    char digits[8 * sizeof(long) + 1];
+    char *p = digits + sizeof(digits);
+    if (base < 2)
+        base = DEC;
+    do
+    {
+        int digit = value % base;
+        *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        value /= base;
+    } while (value != 0);
+    return write((const uint8_t *)p, digits + sizeof(digits) - p);
+}
+
+size_t Print::print(double value, int digits)
+{
+    char buffer[64];
+    int length = snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return write((const uint8_t *)buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        if (available() > 0)
+            return read();
+        delay(1);
+    } while (millis() - start < timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+            break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+String Stream::readString()
+{
+    String result;
+    int c;
+    while ((c = timedRead()) >= 0)
+        result += (char)c;
+    return result;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String result;
+    int c;
+    while ((c = timedRead()) >= 0 && c != terminator)
+        result += (char)c;
+    return result;
+}
+
+void HostStream::inject(const uint8_t *data, size_t size, uint64_t at_us)
+{
+    if (!arriving.empty())
+        at_us = std::max(at_us, arriving.back().at_us);
+    for (size_t i = 0; i < size; ++i)
+        arriving.push_back({at_us, data[i]});
+}
+
+// The bytes that have arrived by now move into the RX buffer, or get dropped if it is full
+void HostStream::receive()
+{
+    uint64_t now = host::now_us();
+    while (!arriving.empty() && arriving.front().at_us <= now)
+    {
+        if (rx_capacity != 0 && received.size() >= rx_capacity)
+            rx_dropped++;
+        else
+            received.push_back(arriving.front().value);
+        arriving.pop_front();
+    }
+}
+
+int HostStream::available()
+{
+    receive();
+    return (int)received.size();
+}
+
+int HostStream::read()
+{
+    receive();
+    if (received.empty())
+        return -1;
+    uint8_t c = received.front();
+    received.pop_front();
+    return c;
+}
+
+int HostStream::peek()
+{
+    receive();
+    return received.empty() ? -1 : received.front();
+}
+
+size_t HostStream::write(const uint8_t *data, size_t size)
+{
+    if (on_write)
+        on_write(data, size);
+    else
+        output.append((const char *)data, size);
+    return size;
+}
@@ -0,0 +1,223 @@
+/**
+ * @file Arduino.h
+ * @brief The host stand-in of the Arduino core: Print, Stream, String, HardwareSerial and the clock.
+ *
+ * Only what the firmware uses, with the signatures of the ESP32 Arduino core. The serial ports
+ * are HostStream instances, the tests feed their input and catch their output, see HostStream.
+ * The chip info (ESP) comes along, like with the ESP32 core.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "HostRuntime.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+inline unsigned long millis() { return (unsigned long)(host::now_us() / 1000); }
+// 32 bits on the ESP32, it wraps around every 71 minutes
+inline unsigned long micros() { return (uint32_t)host::now_us(); }
+inline void delay(uint32_t ms) { host::delay_ticks(ms / portTICK_PERIOD_MS); }
+inline void yield() { host::delay_ticks(0); }
+
+class String
+{
+public:
+    String(const char *text = "") : text(text ? text : "") {}
+    String(const __FlashStringHelper *text) : String(reinterpret_cast<const char *>(text)) {}
+    explicit String(char c) : text(1, c) {}
+    explicit String(int value) : text(std::to_string(value)) {}
+    explicit String(unsigned int value) : text(std::to_string(value)) {}
+    explicit String(long value) : text(std::to_string(value)) {}
+    explicit String(unsigned long value) : text(std::to_string(value)) {}
+
+    const char *c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.length(); }
+    char operator[](unsigned int index) const { return index < text.size() ? text[index] : 0; }
+
+    bool concat(const String &other) { return concat(other.c_str()); }
+    bool concat(const char *other)
+    {
+        text += other;
+        return true;
+    }
+    bool concat(char c)
+    {
+        text += c;
+        return true;
+    }
+    String &operator+=(const String &other) { return concat(other), *this; }
+    String &operator+=(const char *other) { return concat(other), *this; }
+    String &operator+=(char c) { return concat(c), *this; }
+    friend String operator+(String left, const String &right) { return left += right; }
+    friend String operator+(String left, const char *right) { return left += right; }
+
+    bool operator==(const String &other) const { return text == other.text; }
+    bool operator==(const char *other) const { return text == other; }
+    bool operator!=(const String &other) const { return text != other.text; }
+    bool equals(const String &other) const { return text == other.text; }
+    bool startsWith(const String &prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return text.size() >= suffix.text.size() &&
+               text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return found(text.find(c, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return found(text.find(s.text, from)); }
+    int lastIndexOf(char c) const { return found(text.rfind(c)); }
+    String substring(unsigned int from) const { return substring(from, text.size()); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+            std::swap(from, to);
+        from = std::min<unsigned int>(from, text.size());
+        to = std::min<unsigned int>(to, text.size());
+        return String(text.substr(from, to - from).c_str());
+    }
+    void trim();
+    long toInt() const { return std::strtol(text.c_str(), nullptr, 10); }
+
+private:
+    std::string text;
+
+    static int found(size_t position) { return position == std::string::npos ? -1 : (int)position; }
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t size);
+    size_t write(const char *text) { return text ? write((const uint8_t *)text, strlen(text)) : 0; }
+    size_t write(const char *data, size_t size) { return write((const uint8_t *)data, size); }
+    virtual void flush() {}
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const __FlashStringHelper *text) { return write(reinterpret_cast<const char *>(text)); }
+    size_t print(const String &text) { return write(text.c_str(), text.length()); }
+    size_t print(const char text[]) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(long long value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned long long value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T &value, int base)
+    {
+        size_t n = print(value, base);
+        return n + println();
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout_ms) { timeout = timeout_ms; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long timeout = 1000;
+
+    // Waits for a byte up to the timeout, -1 on the timeout
+    int timedRead();
+};
+
+/**
+ * The serial port of the host tests: the input is delivered at the virtual time it arrives,
+ * the output goes to on_write, or collects in output if there is no on_write.
+ * A port with rx_capacity drops the bytes arriving while its RX buffer is full (no flow control).
+ */
+class HostStream : public Stream
+{
+public:
+    std::function<void(const uint8_t *, size_t)> on_write;
+    std::string output;
+    size_t rx_capacity = 0; // 0 for unlimited
+    uint32_t rx_dropped = 0;
+
+    // The bytes the firmware is going to read, they arrive at the virtual time at_us
+    void inject(const uint8_t *data, size_t size, uint64_t at_us);
+    void inject(const std::string &text) { inject((const uint8_t *)text.data(), text.size(), host::now_us()); }
+    size_t pending() const { return arriving.size() + received.size(); }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+
+private:
+    struct Arrival
+    {
+        uint64_t at_us;
+        uint8_t value;
+    };
+    std::deque<Arrival> arriving; // in the arrival order
+    std::deque<uint8_t> received; // in the RX buffer
+
+    void receive();
+};
+
+class HardwareSerial : public HostStream
+{
+public:
+    void begin(unsigned long baud) { this->baud = baud; }
+    unsigned long baudRate() const { return baud; }
+    operator bool() const { return true; }
+
+private:
+    unsigned long baud = 0;
+};
+
+extern HardwareSerial Serial;
+
+#include "ESP.h"
@@ -0,0 +1,26 @@
+/**
+ * @file BluetoothSerial.h
+ * @brief The host stand-in of the ESP32 BT SPP port, a HostStream like the serial ports.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+class BluetoothSerial : public HostStream
+{
+public:
+    bool begin(const String &local_name, bool is_master = false)
+    {
+        (void)is_master;
+        name = local_name;
+        return true;
+    }
+    bool hasClient() { return true; }
+
+private:
+    String name;
+};
@@ -0,0 +1,122 @@
+/**
+ * @file CommandProcessor.h
+ * @brief The host stand-in of the command processor: the commands of the soak traces, with their CPU cost.
+ *
+ * The clock and the schedule commands go to the real ClockHelper and ScheduleManager, a crontab
+ * change is saved into SPIFFS like on the controller. The path player only keeps its state.
+ * Every command consumes its cost on the virtual clock under the command lock of main.cpp.
+ *
+ *     {"command":"path_player_switch","player":"on"}
+ *     {"command":"set_date_time","date_time":"2026-10-19T21:00:00"}
+ *     {"command":"add_task","schedule":"0 7 * * *"}   the task switches the player on
+ *     {"command":"delete_task","index":3}
+ *     {"command":"list_tasks"}
+ *     {"command":"get_agenda","hours":24}
+ *
+ * An unknown command fails, it still costs the parsing.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+#include <string>
+
+#include "StreamLogger.h"
+#include "ClockHelper.h"
+#include "ScheduleManager.h"
+#include "PathManager.h"
+
+class CommandProcessor
+{
+public:
+    // The CPU time of the commands, the ESP32 at 240 MHz with ArduinoJson
+    static const uint32_t parse_us = 300;
+    static const uint32_t player_switch_us = 1500;
+    static const uint32_t clock_us = 800;
+    static const uint32_t crontab_us = 2000; // the flash writes of the crontab are charged by SPIFFS
+    static const uint32_t list_us = 20000;
+
+    struct Stats
+    {
+        uint32_t processed = 0;
+        uint32_t failed = 0;
+        uint32_t player_switches = 0;
+        uint32_t clock_syncs = 0;
+        uint32_t crontab_changes = 0;
+    };
+
+    bool process_command(std::string &config)
+    {
+        stats.processed++;
+        host::consume_us(parse_us);
+        std::string command = field(config, "command");
+        bool done = false;
+        if (command == "path_player_switch")
+        {
+            host::consume_us(player_switch_us);
+            path_manager.set_playing(field(config, "player") == "on");
+            stats.player_switches++;
+            done = true;
+        }
+        else if (command == "set_date_time")
+        {
+            host::consume_us(clock_us);
+            done = runtime_clock_helper.set_controller_clock(field(config, "date_time"));
+            stats.clock_syncs++;
+        }
+        else if (command == "add_task" || command == "delete_task")
+        {
+            if (command == "add_task")
+                schedule_manager.addTask(field(config, "schedule"), player_on);
+            else
+                schedule_manager.deleteTask(std::atoi(field(config, "index").c_str()));
+            schedule_manager.saveToSpiffs();
+            host::consume_us(crontab_us);
+            stats.crontab_changes++;
+            done = true;
+        }
+        else if (command == "list_tasks")
+        {
+            schedule_manager.listTasks();
+            host::consume_us(list_us);
+            done = true;
+        }
+        else if (command == "get_agenda")
+        {
+            int hours = std::atoi(field(config, "hours").c_str());
+            schedule_manager.printAgenda(hours > 0 ? hours : 24);
+            host::consume_us(list_us);
+            done = true;
+        }
+        stats.failed += !done;
+        return done;
+    }
+
+    const Stats &get_stats() const { return stats; }
+
+private:
+    const std::string player_on = "{\"command\":\"path_player_switch\",\"player\":\"on\"}";
+    Stats stats;
+
+    // The value of "name":"text" or "name":number in the flat JSON of the command
+    static std::string field(const std::string &config, const char *name)
+    {
+        std::string key = std::string("\"") + name + "\":";
+        size_t at = config.find(key);
+        if (at == std::string::npos)
+            return "";
+        at += key.size();
+        if (at < config.size() && config[at] == '"')
+        {
+            size_t end = config.find('"', at + 1);
+            return end == std::string::npos ? "" : config.substr(at + 1, end - at - 1);
+        }
+        size_t end = config.find_first_of(",}", at);
+        return config.substr(at, end == std::string::npos ? std::string::npos : end - at);
+    }
+};
@@ -0,0 +1,54 @@
+/**
+ * @file ESP.h
+ * @brief The host stand-in of the ESP32 chip info, the free heap follows the allocations of the process.
+ *
+ * The heap starts at the free heap of the controller after the boot, every byte the process holds
+ * beyond what it held at the first reading is taken from it (malloc, new, the std containers,
+ * in every task), so the heap growth of the soak runs is the growth of the firmware.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+#include <malloc.h>
+
+class EspClass
+{
+public:
+    uint32_t getFreeHeap()
+    {
+        size_t held = allocated();
+        if (baseline == 0)
+            baseline = held;
+        int64_t free_heap = (int64_t)heap_at_boot - ((int64_t)held - (int64_t)baseline);
+        uint32_t result = (uint32_t)std::max<int64_t>(0, free_heap);
+        min_free = std::min(min_free, result);
+        return result;
+    }
+    // The lowest free heap read so far
+    uint32_t getMinFreeHeap() { return std::min(min_free, getFreeHeap()); }
+    uint32_t getHeapSize() { return heap_size; }
+    uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+    const char *getSdkVersion() { return "host"; }
+
+private:
+    static const uint32_t heap_size = 327680;
+    static const uint32_t heap_at_boot = 290000; // what the WiFi-less sketch has left
+    size_t baseline = 0;
+    uint32_t min_free = UINT32_MAX;
+
+    // The bytes in use in the malloc arena and in the mmapped blocks
+    static size_t allocated()
+    {
+        struct mallinfo2 info = mallinfo2();
+        return info.uordblks + info.hblkhd;
+    }
+};
+
+extern EspClass ESP;
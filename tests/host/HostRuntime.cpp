@@ -0,0 +1,426 @@
+/**
+ * @file HostRuntime.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "HostRuntime.h"
+
+#include <sys/time.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const uint64_t us_per_tick = 1000;
+    const uint64_t no_wake = UINT64_MAX;
+}
+
+struct HostTask
+{
+    enum class State
+    {
+        READY,
+        RUNNING,
+        BLOCKED,
+        DEAD
+    };
+
+    std::string name;
+    int priority = 0;
+    State state = State::READY;
+    uint64_t ready_sequence = 0;   // FIFO among the equal priorities
+    uint64_t wake_us = no_wake;    // the timeout of the blocked task
+    HostSemaphore *waiting = nullptr;
+    std::condition_variable turn;
+    void (*entry)(void *) = nullptr;
+    void *param = nullptr;
+};
+
+struct HostSemaphore
+{
+    host::SemaphoreKind kind;
+    uint32_t max_count;
+    uint32_t count;
+    HostTask *owner = nullptr; // the recursive mutex
+    uint32_t depth = 0;
+    std::deque<HostTask *> waiters;
+};
+
+namespace
+{
+    struct Kernel
+    {
+        std::mutex lock;
+        std::vector<HostTask *> tasks;
+        HostTask *current = nullptr;
+        uint64_t now_us = 0;
+        uint64_t next_sequence = 0;
+        int64_t wall_offset_us = 0; // the wall clock minus now_us
+    };
+
+    Kernel &kernel()
+    {
+        static Kernel *instance = new Kernel(); // never destroyed, the tasks outlive main()
+        return *instance;
+    }
+
+    thread_local HostTask *self = nullptr;
+
+    void make_ready(Kernel &k, HostTask *task)
+    {
+        task->state = HostTask::State::READY;
+        task->ready_sequence = k.next_sequence++;
+        task->wake_us = no_wake;
+    }
+
+    // The calling thread's task, main() becomes the loopTask on the first call
+    HostTask *running(Kernel &k)
+    {
+        if (self != nullptr)
+            return self;
+        if (k.current != nullptr)
+        {
+            std::fprintf(stderr, "HostRuntime: a thread outside the kernel called into it\n");
+            std::abort();
+        }
+        self = new HostTask();
+        self->name = "loopTask";
+        self->priority = 1;
+        self->state = HostTask::State::RUNNING;
+        k.tasks.push_back(self);
+        k.current = self;
+        return self;
+    }
+
+    // The blocked tasks whose timeout has come are ready again, their take fails
+    void release_expired(Kernel &k)
+    {
+        for (HostTask *task : k.tasks)
+        {
+            if (task->state != HostTask::State::BLOCKED || task->wake_us > k.now_us)
+                continue;
+            if (task->waiting != nullptr)
+            {
+                auto &waiters = task->waiting->waiters;
+                waiters.erase(std::remove(waiters.begin(), waiters.end(), task), waiters.end());
+                task->waiting = nullptr;
+            }
+            make_ready(k, task);
+        }
+    }
+
+    HostTask *pick(Kernel &k)
+    {
+        while (true)
+        {
+            release_expired(k);
+            HostTask *best = nullptr;
+            uint64_t earliest = no_wake;
+            for (HostTask *task : k.tasks)
+            {
+                if (task->state == HostTask::State::READY &&
+                    (best == nullptr || task->priority > best->priority ||
+                     (task->priority == best->priority && task->ready_sequence < best->ready_sequence)))
+                    best = task;
+                if (task->state == HostTask::State::BLOCKED)
+                    earliest = std::min(earliest, task->wake_us);
+            }
+            if (best != nullptr)
+                return best;
+            if (earliest == no_wake)
+            {
+                std::fprintf(stderr, "HostRuntime: every task is blocked forever\n");
+                std::abort();
+            }
+            k.now_us = earliest; // nothing to run, the time jumps to the next wake up
+        }
+    }
+
+    // The running task has set its own state, the next task runs until it switches back
+    void switch_away(Kernel &k, std::unique_lock<std::mutex> &guard, HostTask *task)
+    {
+        HostTask *next = pick(k);
+        k.current = next;
+        next->state = HostTask::State::RUNNING;
+        if (next == task)
+            return;
+        next->turn.notify_one();
+        if (task->state == HostTask::State::DEAD)
+            return;
+        task->turn.wait(guard, [&]
+                        { return k.current == task; });
+    }
+
+    void preempt_if_higher(Kernel &k, std::unique_lock<std::mutex> &guard, HostTask *task, int priority)
+    {
+        if (priority <= task->priority)
+            return;
+        make_ready(k, task);
+        switch_away(k, guard, task);
+    }
+
+    void task_thread(HostTask *task)
+    {
+        Kernel &k = kernel();
+        {
+            std::unique_lock<std::mutex> guard(k.lock);
+            self = task;
+            task->turn.wait(guard, [&]
+                            { return k.current == task; });
+        }
+        task->entry(task->param);
+        std::unique_lock<std::mutex> guard(k.lock);
+        task->state = HostTask::State::DEAD;
+        switch_away(k, guard, task);
+    }
+}
+
+namespace host
+{
+    uint64_t now_us()
+    {
+        Kernel &k = kernel();
+        std::lock_guard<std::mutex> guard(k.lock);
+        return k.now_us;
+    }
+
+    void consume_us(uint64_t us)
+    {
+        Kernel &k = kernel();
+        std::unique_lock<std::mutex> guard(k.lock);
+        HostTask *task = running(k);
+        uint64_t remaining = us;
+        uint64_t slice_start = k.now_us; // a task running since a tick boundary has the slice till the next one
+        while (true)
+        {
+            release_expired(k);
+            uint64_t end = k.now_us + remaining;
+            bool higher_ready = false, equal_ready = false;
+            uint64_t stop_at = end;
+            for (HostTask *other : k.tasks)
+            {
+                if (other == task)
+                    continue;
+                if (other->state == HostTask::State::READY)
+                {
+                    higher_ready |= other->priority > task->priority;
+                    equal_ready |= other->priority == task->priority;
+                }
+                else if (other->state == HostTask::State::BLOCKED && other->priority > task->priority)
+                    stop_at = std::min(stop_at, other->wake_us);
+                else if (other->state == HostTask::State::BLOCKED && other->priority == task->priority)
+                    stop_at = std::min(stop_at, other->wake_us); // then sliced at the tick boundary
+            }
+            if (higher_ready)
+            {
+                // the preempted task goes first among its equals once the higher ones block
+                task->state = HostTask::State::READY;
+                task->ready_sequence = 0;
+                switch_away(k, guard, task);
+                slice_start = k.now_us;
+                continue;
+            }
+            if (equal_ready && k.now_us % us_per_tick == 0 && k.now_us != slice_start && k.now_us < end)
+            {
+                // the time slice is over, the equal ones take turns on the tick
+                make_ready(k, task);
+                switch_away(k, guard, task);
+                slice_start = k.now_us;
+                continue;
+            }
+            if (equal_ready)
+                stop_at = std::min(stop_at, (k.now_us / us_per_tick + 1) * us_per_tick);
+            if (stop_at >= end)
+            {
+                k.now_us = end;
+                return;
+            }
+            if (stop_at > k.now_us)
+            {
+                remaining -= stop_at - k.now_us;
+                k.now_us = stop_at;
+            }
+        }
+    }
+
+    void sleep_until_us(uint64_t wake_us)
+    {
+        Kernel &k = kernel();
+        std::unique_lock<std::mutex> guard(k.lock);
+        HostTask *task = running(k);
+        if (wake_us <= k.now_us)
+            make_ready(k, task); // a yield
+        else
+        {
+            task->state = HostTask::State::BLOCKED;
+            task->wake_us = wake_us;
+        }
+        switch_away(k, guard, task);
+    }
+
+    void delay_ticks(uint32_t ticks)
+    {
+        uint64_t now = now_us();
+        sleep_until_us(ticks == 0 ? now : (now / us_per_tick + ticks) * us_per_tick);
+    }
+
+    void set_wall_clock(std::time_t utc)
+    {
+        Kernel &k = kernel();
+        std::lock_guard<std::mutex> guard(k.lock);
+        k.wall_offset_us = (int64_t)utc * 1000000 - (int64_t)k.now_us;
+    }
+
+    HostTask *task_create(void (*entry)(void *), const char *name, void *param, int priority)
+    {
+        Kernel &k = kernel();
+        std::unique_lock<std::mutex> guard(k.lock);
+        HostTask *creator = running(k);
+        HostTask *task = new HostTask();
+        task->name = name;
+        task->priority = priority;
+        task->entry = entry;
+        task->param = param;
+        make_ready(k, task);
+        k.tasks.push_back(task);
+        std::thread(task_thread, task).detach();
+        preempt_if_higher(k, guard, creator, priority);
+        return task;
+    }
+
+    void critical_enter()
+    {
+    }
+
+    void critical_exit()
+    {
+    }
+
+    const char *task_name(HostTask *task)
+    {
+        return task->name.c_str();
+    }
+
+    HostSemaphore *semaphore_create(SemaphoreKind kind, uint32_t max_count, uint32_t initial_count)
+    {
+        HostSemaphore *semaphore = new HostSemaphore();
+        semaphore->kind = kind;
+        semaphore->max_count = max_count;
+        semaphore->count = initial_count;
+        return semaphore;
+    }
+
+    bool semaphore_take(HostSemaphore *semaphore, uint32_t ticks)
+    {
+        Kernel &k = kernel();
+        std::unique_lock<std::mutex> guard(k.lock);
+        HostTask *task = running(k);
+        uint64_t deadline = ticks == wait_forever ? no_wake : (k.now_us / us_per_tick + ticks) * us_per_tick;
+        while (true)
+        {
+            if (semaphore->kind == SemaphoreKind::RECURSIVE_MUTEX && semaphore->owner == task)
+            {
+                semaphore->depth++;
+                return true;
+            }
+            if (semaphore->count > 0)
+            {
+                semaphore->count--;
+                if (semaphore->kind == SemaphoreKind::RECURSIVE_MUTEX)
+                    semaphore->owner = task, semaphore->depth = 1;
+                return true;
+            }
+            if (ticks == 0 || k.now_us >= deadline)
+                return false;
+
+            // woken by a give or the timeout, either way it tries again, like FreeRTOS:
+            // a task of the same priority running meanwhile may take it first
+            task->state = HostTask::State::BLOCKED;
+            task->wake_us = deadline;
+            task->waiting = semaphore;
+            semaphore->waiters.push_back(task);
+            switch_away(k, guard, task);
+        }
+    }
+
+    bool semaphore_give(HostSemaphore *semaphore)
+    {
+        Kernel &k = kernel();
+        std::unique_lock<std::mutex> guard(k.lock);
+        HostTask *task = running(k);
+        if (semaphore->kind == SemaphoreKind::RECURSIVE_MUTEX)
+        {
+            if (semaphore->owner != task)
+                return false;
+            if (--semaphore->depth > 0)
+                return true;
+            semaphore->owner = nullptr;
+        }
+        if (semaphore->count >= semaphore->max_count)
+            return false;
+        semaphore->count++;
+        if (semaphore->waiters.empty())
+            return true;
+
+        // wake the highest priority waiter, the longest waiting among the equal ones
+        auto best = semaphore->waiters.begin();
+        for (auto it = semaphore->waiters.begin(); it != semaphore->waiters.end(); ++it)
+            if ((*it)->priority > (*best)->priority)
+                best = it;
+        HostTask *waiter = *best;
+        semaphore->waiters.erase(best);
+        waiter->waiting = nullptr;
+        make_ready(k, waiter);
+        preempt_if_higher(k, guard, task, waiter->priority);
+        return true;
+    }
+
+    void finish(int code)
+    {
+        std::fflush(stdout);
+        std::fflush(stderr);
+        std::_Exit(code);
+    }
+}
+
+// The wall clock of the firmware, the libc calls resolve to these in the test executables
+extern "C" std::time_t time(std::time_t *result) noexcept
+{
+    Kernel &k = kernel();
+    std::lock_guard<std::mutex> guard(k.lock);
+    int64_t wall_us = (int64_t)k.now_us + k.wall_offset_us;
+    std::time_t seconds = (std::time_t)(wall_us / 1000000);
+    if (result != nullptr)
+        *result = seconds;
+    return seconds;
+}
+
+extern "C" int gettimeofday(struct timeval *__restrict tv, void *__restrict) noexcept
+{
+    Kernel &k = kernel();
+    std::lock_guard<std::mutex> guard(k.lock);
+    int64_t wall_us = (int64_t)k.now_us + k.wall_offset_us;
+    tv->tv_sec = (time_t)(wall_us / 1000000);
+    tv->tv_usec = (suseconds_t)(wall_us % 1000000);
+    return 0;
+}
+
+extern "C" int settimeofday(const struct timeval *tv, const struct timezone *) noexcept
+{
+    Kernel &k = kernel();
+    std::lock_guard<std::mutex> guard(k.lock);
+    k.wall_offset_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec - (int64_t)k.now_us;
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file HostRuntime.h
+ * @brief The virtual clock and the simulated FreeRTOS kernel behind the host stand-ins.
+ *
+ * The firmware runs on the host unchanged, its FreeRTOS tasks become threads, but only one of them
+ * runs at a time, like on a single core: the highest priority ready task, FIFO among the equal ones.
+ * The time is virtual, it stands still while a task runs and jumps to the next wake up when
+ * every task is blocked, so the days of the uptime take seconds and every run is reproducible.
+ *
+ * - vTaskDelay() wakes on the tick boundaries (1 ms), like FreeRTOS;
+ * - consume_us() models the CPU work of the running task, the higher priority tasks waking
+ *   meanwhile preempt it, the ready tasks of the same priority take turns on every tick
+ *   (the time slicing of the ESP-IDF FreeRTOS);
+ * - a semaphore give wakes the highest priority waiter, switching to it right away if it is
+ *   higher; the woken task takes the semaphore when it runs, so a task of the same priority
+ *   giving and taking it again without a yield keeps it, like on FreeRTOS
+ *   (no priority inheritance though);
+ * - time(), gettimeofday() and settimeofday() read and set the virtual wall clock.
+ *
+ * The calling thread of main() is the "loopTask", priority 1.
+ *
+ * HostRuntimeThreaded.cpp is the other implementation of these calls, the tasks run in parallel
+ * on the host time, for the ThreadSanitizer stress tests.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <ctime>
+
+struct HostTask;
+struct HostSemaphore;
+
+namespace host
+{
+    const uint32_t wait_forever = 0xffffffffUL;
+
+    // Microseconds since the boot
+    uint64_t now_us();
+    // The CPU work of the running task, the time advances by it
+    void consume_us(uint64_t us);
+    // Blocks the running task, the other tasks run meanwhile
+    void delay_ticks(uint32_t ticks);
+    void sleep_until_us(uint64_t wake_us);
+
+    // The wall clock of time() and gettimeofday(), settimeofday() moves it as well
+    void set_wall_clock(std::time_t utc);
+
+    // portENTER_CRITICAL(), nothing to do on the simulated single core
+    void critical_enter();
+    void critical_exit();
+
+    HostTask *task_create(void (*entry)(void *), const char *name, void *param, int priority);
+    const char *task_name(HostTask *task);
+
+    enum class SemaphoreKind
+    {
+        MUTEX,
+        RECURSIVE_MUTEX,
+        COUNTING
+    };
+    HostSemaphore *semaphore_create(SemaphoreKind kind, uint32_t max_count, uint32_t initial_count);
+    bool semaphore_take(HostSemaphore *semaphore, uint32_t ticks);
+    bool semaphore_give(HostSemaphore *semaphore);
+
+    // Ends the process without unwinding the tasks blocked forever
+    [[noreturn]] void finish(int code);
+}
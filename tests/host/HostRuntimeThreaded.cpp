@@ -0,0 +1,216 @@
+/**
+ * @file HostRuntimeThreaded.cpp
+ * @brief The free running flavour of the host runtime, for the ThreadSanitizer stress tests.
+ *
+ * The same host:: calls as HostRuntime.cpp, but every task is a host thread running in parallel
+ * with the others, on as many cores as the host has, and the semaphores are real locks. The time
+ * is the host time sped up by time_scale, a virtual second passes in a millisecond, so the
+ * scheduler ticks often enough to race the writers. Nothing is reproducible here,
+ * the simulated kernel is the one for the behaviour, this one is for the data races.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "HostRuntime.h"
+
+#include <sys/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace
+{
+    const uint64_t time_scale = 1000; // the virtual microseconds per host microsecond
+    const uint64_t us_per_tick = 1000;
+
+    const std::chrono::steady_clock::time_point &boot()
+    {
+        static const std::chrono::steady_clock::time_point instance = std::chrono::steady_clock::now();
+        return instance;
+    }
+
+    std::atomic<int64_t> wall_offset_us{0}; // the wall clock minus now_us
+
+    // The host time of the virtual microseconds
+    std::chrono::nanoseconds host_duration(uint64_t us)
+    {
+        return std::chrono::nanoseconds(us * 1000 / time_scale);
+    }
+
+    std::recursive_mutex &critical_lock()
+    {
+        static std::recursive_mutex *instance = new std::recursive_mutex(); // the tasks outlive main()
+        return *instance;
+    }
+}
+
+struct HostTask
+{
+    std::string name;
+    void (*entry)(void *) = nullptr;
+    void *param = nullptr;
+};
+
+struct HostSemaphore
+{
+    host::SemaphoreKind kind;
+    uint32_t max_count;
+    uint32_t count;
+    std::thread::id owner; // the recursive mutex
+    uint32_t depth = 0;
+    std::mutex lock;
+    std::condition_variable given;
+};
+
+namespace host
+{
+    uint64_t now_us()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - boot();
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() * time_scale / 1000;
+    }
+
+    // The work runs on its own core, it only takes the time
+    void consume_us(uint64_t us)
+    {
+        std::this_thread::sleep_for(host_duration(us));
+    }
+
+    void delay_ticks(uint32_t ticks)
+    {
+        if (ticks == 0)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(host_duration((uint64_t)ticks * us_per_tick));
+    }
+
+    void sleep_until_us(uint64_t wake_us)
+    {
+        uint64_t now = now_us();
+        if (wake_us > now)
+            std::this_thread::sleep_for(host_duration(wake_us - now));
+    }
+
+    void set_wall_clock(std::time_t utc)
+    {
+        wall_offset_us = (int64_t)utc * 1000000 - (int64_t)now_us();
+    }
+
+    void critical_enter()
+    {
+        critical_lock().lock();
+    }
+
+    void critical_exit()
+    {
+        critical_lock().unlock();
+    }
+
+    HostTask *task_create(void (*entry)(void *), const char *name, void *param, int priority)
+    {
+        (void)priority; // every task has a core of its own
+        HostTask *task = new HostTask();
+        task->name = name;
+        task->entry = entry;
+        task->param = param;
+        std::thread([task]()
+                    { task->entry(task->param); })
+            .detach();
+        return task;
+    }
+
+    const char *task_name(HostTask *task)
+    {
+        return task->name.c_str();
+    }
+
+    HostSemaphore *semaphore_create(SemaphoreKind kind, uint32_t max_count, uint32_t initial_count)
+    {
+        HostSemaphore *semaphore = new HostSemaphore();
+        semaphore->kind = kind;
+        semaphore->max_count = max_count;
+        semaphore->count = initial_count;
+        return semaphore;
+    }
+
+    bool semaphore_take(HostSemaphore *semaphore, uint32_t ticks)
+    {
+        std::unique_lock<std::mutex> guard(semaphore->lock);
+        std::thread::id me = std::this_thread::get_id();
+        if (semaphore->kind == SemaphoreKind::RECURSIVE_MUTEX && semaphore->depth > 0 && semaphore->owner == me)
+        {
+            semaphore->depth++;
+            return true;
+        }
+        auto available = [semaphore]()
+        { return semaphore->count > 0; };
+        if (ticks == wait_forever)
+            semaphore->given.wait(guard, available);
+        else if (!semaphore->given.wait_for(guard, host_duration((uint64_t)ticks * us_per_tick), available))
+            return false;
+        semaphore->count--;
+        if (semaphore->kind == SemaphoreKind::RECURSIVE_MUTEX)
+        {
+            semaphore->owner = me;
+            semaphore->depth = 1;
+        }
+        return true;
+    }
+
+    bool semaphore_give(HostSemaphore *semaphore)
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->kind == SemaphoreKind::RECURSIVE_MUTEX)
+        {
+            if (semaphore->depth == 0 || semaphore->owner != std::this_thread::get_id())
+                return false;
+            if (--semaphore->depth > 0)
+                return true;
+            semaphore->owner = std::thread::id();
+        }
+        if (semaphore->count >= semaphore->max_count)
+            return false;
+        semaphore->count++;
+        semaphore->given.notify_one();
+        return true;
+    }
+
+    void finish(int code)
+    {
+        std::fflush(stdout);
+        std::fflush(stderr);
+        std::_Exit(code);
+    }
+}
+
+// The wall clock of the firmware, the libc calls resolve to these in the test executables
+extern "C" std::time_t time(std::time_t *result) noexcept
+{
+    std::time_t seconds = (std::time_t)(((int64_t)host::now_us() + wall_offset_us) / 1000000);
+    if (result != nullptr)
+        *result = seconds;
+    return seconds;
+}
+
+extern "C" int gettimeofday(struct timeval *__restrict tv, void *__restrict) noexcept
+{
+    int64_t wall_us = (int64_t)host::now_us() + wall_offset_us;
+    tv->tv_sec = (time_t)(wall_us / 1000000);
+    tv->tv_usec = (suseconds_t)(wall_us % 1000000);
+    return 0;
+}
+
+extern "C" int settimeofday(const struct timeval *tv, const struct timezone *) noexcept
+{
+    wall_offset_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec - (int64_t)host::now_us();
+    return 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file LaserHelper.h
+ * @brief The host stand-in of the laser pin driver, main.cpp only sets it up.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+class LaserHelper
+{
+public:
+    bool delayed_setup() { return true; }
+    void set_laser(bool on) { this->on = on; }
+    bool is_on() const { return on; }
+
+private:
+    bool on = false;
+};
@@ -0,0 +1,82 @@
+/**
+ * @file LoopbackLink.h
+ * @brief Connects two host streams through a link with the bandwidth, the latency and the loss.
+ *
+ * Every write is one packet: it occupies the link for per_write_us plus its bytes at bytes_per_s,
+ * arrives latency_us after it is fully sent, and is lost with the probability loss.
+ * The random sequence is seeded, so a run with the same seed loses the same packets.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+#include <random>
+
+class LoopbackLink
+{
+public:
+    struct Config
+    {
+        uint32_t bytes_per_s = 40000;
+        uint32_t latency_us = 15000;
+        uint32_t per_write_us = 300;
+        double loss = 0.0;
+        uint32_t seed = 1;
+    };
+
+    struct Stats
+    {
+        uint32_t packets;
+        uint32_t lost;
+        uint64_t bytes;
+    };
+
+    LoopbackLink(HostStream &a, HostStream &b, const Config &config)
+        : a(a), b(b), config(config), random(config.seed)
+    {
+        a.on_write = [this, &b](const uint8_t *data, size_t size)
+        { send(a_to_b, b, data, size); };
+        b.on_write = [this, &a](const uint8_t *data, size_t size)
+        { send(b_to_a, a, data, size); };
+    }
+
+    ~LoopbackLink()
+    {
+        a.on_write = nullptr;
+        b.on_write = nullptr;
+    }
+
+    const Stats &get_stats() const { return stats; }
+
+private:
+    struct Direction
+    {
+        uint64_t busy_until_us = 0;
+    };
+
+    HostStream &a;
+    HostStream &b;
+    Config config;
+    std::mt19937 random;
+    Direction a_to_b, b_to_a;
+    Stats stats = {};
+
+    void send(Direction &direction, HostStream &to, const uint8_t *data, size_t size)
+    {
+        uint64_t start = std::max(host::now_us(), direction.busy_until_us);
+        direction.busy_until_us = start + config.per_write_us + (uint64_t)size * 1000000 / config.bytes_per_s;
+        stats.packets++;
+        stats.bytes += size;
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(random) < config.loss)
+        {
+            stats.lost++;
+            return;
+        }
+        to.inject(data, size, direction.busy_until_us + config.latency_us);
+    }
+};
@@ -0,0 +1,30 @@
+/**
+ * @file PathManager.h
+ * @brief The host stand-in of the path storage and the path player, it keeps the player state only.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+class PathManager
+{
+public:
+    bool delayed_setup() { return true; }
+    void set_playing(bool on)
+    {
+        switches += on != playing;
+        playing = on;
+    }
+    bool is_playing() const { return playing; }
+    uint32_t get_switches() const { return switches; }
+
+private:
+    bool playing = false;
+    uint32_t switches = 0;
+};
+
+inline PathManager path_manager;
@@ -0,0 +1,116 @@
+/**
+ * @file RTClib.h
+ * @brief The host stand-in of the Adafruit RTClib DateTime and RTC_DS3231, the RTC runs on the virtual clock.
+ *
+ * DateTime keeps the library's encoding: the year is stored as the offset from 2000 in a byte,
+ * so a DateTime built from tm_year (124 for 2024) reads back as 2124, like on the hardware.
+ * The RTC keeps the time it was adjusted to and advances it with the virtual clock; until the
+ * first adjust() it reads the virtual wall clock of time(). The tests make it report a power loss.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <cstring>
+#include <ctime>
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class DateTime
+{
+public:
+    DateTime(uint32_t unixtime = SECONDS_FROM_1970_TO_2000)
+    {
+        std::time_t t = unixtime;
+        std::tm tm;
+        gmtime_r(&t, &tm);
+        set(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    }
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0)
+    {
+        set(year, month, day, hour, minute, second);
+    }
+    // __DATE__ "Mmm dd yyyy" and __TIME__ "hh:mm:ss"
+    DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time)
+    {
+        const char *d = reinterpret_cast<const char *>(date);
+        const char *t = reinterpret_cast<const char *>(time);
+        static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        const char *found = strstr(months, std::string(d, 3).c_str());
+        set(atoi(d + 7), found ? (uint8_t)((found - months) / 3 + 1) : 1, (uint8_t)atoi(d + 4),
+            (uint8_t)atoi(t), (uint8_t)atoi(t + 3), (uint8_t)atoi(t + 6));
+    }
+
+    uint16_t year() const { return 2000U + yOff; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+
+    uint32_t unixtime() const
+    {
+        // days from the civil date, month 1-12
+        int y = year() - (m <= 2 ? 1 : 0);
+        int era = y / 400;
+        int yoe = y - era * 400;
+        int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        int64_t days = (int64_t)era * 146097 + doe - 719468;
+        return (uint32_t)(days * 86400 + hh * 3600 + mm * 60 + ss);
+    }
+
+private:
+    uint8_t yOff = 0, m = 1, d = 1, hh = 0, mm = 0, ss = 0;
+
+    void set(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+    {
+        yOff = (uint8_t)(year >= 2000 ? year - 2000 : year);
+        m = month, d = day, hh = hour, mm = minute, ss = second;
+    }
+};
+
+enum Ds3231SqwPinMode
+{
+    DS3231_OFF = 0x1C,
+    DS3231_SquareWave1Hz = 0x00
+};
+
+class RTC_DS3231
+{
+public:
+    bool begin(TwoWire *wire = &Wire)
+    {
+        (void)wire;
+        return true;
+    }
+    // What lostPower() reports, the tests set it: RTC_DS3231::power_lost() = true
+    static bool &power_lost()
+    {
+        static bool lost = false;
+        return lost;
+    }
+    bool lostPower() { return power_lost(); }
+    void adjust(const DateTime &dt)
+    {
+        adjusted = true;
+        offset_s = (int64_t)dt.unixtime() - (int64_t)(host::now_us() / 1000000);
+    }
+    DateTime now()
+    {
+        if (!adjusted)
+            return DateTime((uint32_t)time(nullptr));
+        return DateTime((uint32_t)(offset_s + (int64_t)(host::now_us() / 1000000)));
+    }
+    void writeSqwPinMode(Ds3231SqwPinMode mode) { (void)mode; }
+
+private:
+    bool adjusted = false;
+    int64_t offset_s = 0; // the RTC time minus the virtual uptime
+};
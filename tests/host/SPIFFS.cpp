@@ -0,0 +1,66 @@
+/**
+ * @file SPIFFS.cpp
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "SPIFFS.h"
+
+SPIFFSFS SPIFFS;
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+    size_t count = std::min<size_t>(size, available());
+    if (count > 0)
+        memcpy(buffer, content->data() + position, count);
+    position += count;
+    return count;
+}
+
+size_t File::write(const uint8_t *data, size_t size)
+{
+    if (!content || !writable)
+        return 0;
+    SPIFFS.charge_write(size);
+    content->insert(content->end(), data, data + size);
+    position = content->size();
+    return size;
+}
+
+File SPIFFSFS::open(const char *path, const char *mode, bool create)
+{
+    (void)create;
+    auto it = files.find(path);
+    if (mode[0] == 'r')
+        return it == files.end() ? File() : File(it->second, path, false, 0);
+
+    if (it == files.end() || mode[0] == 'w')
+        it = files.insert_or_assign(path, std::make_shared<std::vector<uint8_t>>()).first;
+    return File(it->second, path, true, it->second->size());
+}
+
+bool SPIFFSFS::rename(const char *from, const char *to)
+{
+    auto it = files.find(from);
+    if (it == files.end() || files.count(to) != 0)
+        return false;
+    files[to] = it->second;
+    files.erase(from);
+    return true;
+}
+
+void SPIFFSFS::charge_write(size_t size) const
+{
+    uint64_t cost = write_cost_us + (uint64_t)size * write_cost_ns_per_byte / 1000;
+    if (cost > 0)
+        host::consume_us(cost);
+}
+
+std::string SPIFFSFS::content_of(const std::string &path) const
+{
+    auto it = files.find(path);
+    return it == files.end() ? std::string() : std::string(it->second->begin(), it->second->end());
+}
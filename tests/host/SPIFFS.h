@@ -0,0 +1,85 @@
+/**
+ * @file SPIFFS.h
+ * @brief The host stand-in of SPIFFS, the files live in memory for the life of the process.
+ *
+ * A write can carry the flash cost (set_write_cost), the writing task consumes the virtual time
+ * of a SPIFFS page program, so the throughput measured on the host includes the flash.
+ *
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File : public Stream
+{
+public:
+    File() {}
+    File(std::shared_ptr<std::vector<uint8_t>> content, const std::string &path, bool writable, size_t position)
+        : content(content), path(path), writable(writable), position(position) {}
+
+    operator bool() const { return content != nullptr; }
+    int available() override { return content ? (int)(content->size() - position) : 0; }
+    int read() override { return available() > 0 ? (*content)[position++] : -1; }
+    int peek() override { return available() > 0 ? (*content)[position] : -1; }
+    size_t read(uint8_t *buffer, size_t size);
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+    size_t size() const { return content ? content->size() : 0; }
+    const char *name() const { return path.c_str(); }
+    void close() { content.reset(); }
+
+private:
+    std::shared_ptr<std::vector<uint8_t>> content;
+    std::string path;
+    bool writable = false;
+    size_t position = 0;
+};
+
+class SPIFFSFS
+{
+public:
+    bool begin(bool format_on_fail = false, const char *base_path = "/spiffs", uint8_t max_open_files = 10)
+    {
+        (void)format_on_fail, (void)base_path, (void)max_open_files;
+        return true;
+    }
+    File open(const char *path, const char *mode = FILE_READ, bool create = false);
+    File open(const String &path, const char *mode = FILE_READ) { return open(path.c_str(), mode); }
+    bool exists(const char *path) const { return files.count(path) != 0; }
+    bool exists(const String &path) const { return exists(path.c_str()); }
+    bool remove(const char *path) { return files.erase(path) != 0; }
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+
+    // The host side: the flash cost of every write, the files of the test
+    void set_write_cost(uint32_t us_per_write, uint32_t ns_per_byte)
+    {
+        write_cost_us = us_per_write;
+        write_cost_ns_per_byte = ns_per_byte;
+    }
+    void charge_write(size_t size) const;
+    void format() { files.clear(); }
+    std::string content_of(const std::string &path) const;
+
+private:
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+    uint32_t write_cost_us = 0;
+    uint32_t write_cost_ns_per_byte = 0;
+};
+
+extern SPIFFSFS SPIFFS;
@@ -0,0 +1,21 @@
+/**
+ * @file ServoAdapter.h
+ * @brief The host stand-in of the PWM servo driver, it remembers the last position.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+class ServoAdapter
+{
+public:
+    void set_position(int position) { this->position = position; }
+    int get_position() const { return position; }
+
+private:
+    int position = 0;
+};
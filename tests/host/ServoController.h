@@ -0,0 +1,15 @@
+/**
+ * @file ServoController.h
+ * @brief The host stand-in of the two axis servo controller, main.cpp only instantiates it.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include "ServoAdapter.h"
+
+class ServoController
+{
+};
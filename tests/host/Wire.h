@@ -0,0 +1,24 @@
+/**
+ * @file Wire.h
+ * @brief The host stand-in of the I2C bus, the RTC stand-in does not talk over it.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+    bool begin() { return true; }
+    bool begin(int sda, int scl, uint32_t frequency = 0)
+    {
+        (void)sda, (void)scl, (void)frequency;
+        return true;
+    }
+};
+
+inline TwoWire Wire;
@@ -0,0 +1,37 @@
+/**
+ * @file FreeRTOS.h
+ * @brief The host stand-in of the FreeRTOS types and macros the firmware uses, see HostRuntime.h.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include <cstdint>
+
+#include "HostRuntime.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+
+#define portMAX_DELAY ((TickType_t)host::wait_forever)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) / portTICK_PERIOD_MS)
+
+// One lock for all the spinlocks, a no-op on the simulated single core
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux), host::critical_enter())
+#define portEXIT_CRITICAL(mux) ((void)(mux), host::critical_exit())
+
+inline BaseType_t xPortGetCoreID() { return 1; }
@@ -0,0 +1,53 @@
+/**
+ * @file semphr.h
+ * @brief The host stand-in of the FreeRTOS semaphores, see HostRuntime.h.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef HostSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return host::semaphore_create(host::SemaphoreKind::MUTEX, 1, 1);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+    return host::semaphore_create(host::SemaphoreKind::RECURSIVE_MUTEX, 1, 1);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return host::semaphore_create(host::SemaphoreKind::COUNTING, 1, 0);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    return host::semaphore_create(host::SemaphoreKind::COUNTING, max_count, initial_count);
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    return host::semaphore_take(semaphore, ticks) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return host::semaphore_give(semaphore) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    return xSemaphoreTake(semaphore, ticks);
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore)
+{
+    return xSemaphoreGive(semaphore);
+}
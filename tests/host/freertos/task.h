@@ -0,0 +1,40 @@
+/**
+ * @file task.h
+ * @brief The host stand-in of the FreeRTOS tasks, see HostRuntime.h.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef HostTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+// The stack depth is not modelled, the task is a host thread
+inline BaseType_t xTaskCreate(TaskFunction_t entry, const char *name, uint32_t stack_depth, void *param,
+                              UBaseType_t priority, TaskHandle_t *handle)
+{
+    (void)stack_depth;
+    TaskHandle_t task = host::task_create(entry, name, param, (int)priority);
+    if (handle != nullptr)
+        *handle = task;
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t entry, const char *name, uint32_t stack_depth,
+                                          void *param, UBaseType_t priority, TaskHandle_t *handle,
+                                          BaseType_t core)
+{
+    (void)core;
+    return xTaskCreate(entry, name, stack_depth, param, priority, handle);
+}
+
+inline void vTaskDelay(TickType_t ticks)
+{
+    host::delay_ticks(ticks);
+}
+
+#define taskYIELD() vTaskDelay(0)